@@ -0,0 +1,97 @@
+#ifndef ORBEXTRACTOR_BRIEF_H
+#define ORBEXTRACTOR_BRIEF_H
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+class BRIEF
+{
+public:
+
+    /** one test per descriptor bit, descriptors have 128, 256 (ORB) or 512 bits */
+    static const int MAX_TESTS = 512;
+
+    /**
+     * GAUSSIAN compares pixels of the 7x7 Gaussian blurred level, BOX compares sums of the (2*BOX_RADIUS+1)^2
+     * box around every test point, taken from an integral image of the level (the sub-window tests of the ORB
+     * paper). Both use the same pattern and steering.
+     */
+    enum Smoothing
+    {
+        GAUSSIAN = 0,
+        BOX = 1
+    };
+
+    static const int BOX_RADIUS = 2;
+
+    /** test points split into the first and second point of every test, as floats for steering */
+    struct Pattern
+    {
+        float x0[MAX_TESTS];
+        float y0[MAX_TESTS];
+        float x1[MAX_TESTS];
+        float y1[MAX_TESTS];
+        int tests = 0;
+
+        Pattern() = default;
+
+        /**
+         * @param points 2*tests points, test i compares points 2i and 2i+1
+         * @param tests multiple of 8 up to MAX_TESTS
+         */
+        Pattern(const cv::Point* points, int tests);
+    };
+
+    /**
+     * Pixel offsets of both points of every test, rotated by angle degrees and rounded to the nearest pixel
+     * like the original per keypoint rotation. Shared by every BRIEF path, so their descriptors are bit exact.
+     * @param off0, off1 pattern.tests offsets each
+     */
+    static void Steer(const Pattern &pattern, float angle, int step, int* off0, int* off1);
+
+    /**
+     * BITS/8 byte descriptor, bit i%8 of byte i/8 is set if center[off0[i]] < center[off1[i]]. The AVX-512/AVX2
+     * paths gather 16/8 tests per instruction with 32 bit loads, so up to 3 bytes behind the furthest test
+     * point are read. Instantiated for 128, 256 and 512 bits.
+     */
+    template <int BITS>
+    static void Describe(const uchar* center, const int* off0, const int* off1, uchar* descriptor);
+
+    /** per bit reference of Describe */
+    template <int BITS>
+    static void DescribeScalar(const uchar* center, const int* off0, const int* off1, uchar* descriptor);
+
+    /**
+     * Prefetches the rows of the square of the given radius around center, e.g. the footprint of the next keypoint
+     * while the current one is described. On large levels footprints are rarely cached and every test row is a
+     * miss otherwise; the gathers of one descriptor reach all rows at once, so test order does not matter.
+     * @param rowBytes row stride of the image, elemBytes bytes per pixel
+     */
+    static void PrefetchFootprint(const uchar* center, size_t rowBytes, int elemBytes, int radius);
+
+    /**
+     * Inclusive integral image of level and border pixels around it, modulo 2^32 (box sums stay exact).
+     * @param level ROI with at least border valid pixels on every side
+     * @param sums CV_32S with level.rows + 2*border rows and level.step1() columns, so BRIEF offsets steered for
+     * the level also apply to it; sums(border + y, border + x) belongs to level pixel (y, x)
+     */
+    static void BoxSums(const cv::Mat &level, int border, cv::Mat &sums);
+
+    /**
+     * Like Describe, but compares the BOX_RADIUS box sums around the test points. Reads BOX_RADIUS + 1 rows and
+     * columns beyond the furthest test point.
+     * @param center element of the integral image at the keypoint
+     * @param step row stride of the integral image in elements
+     */
+    template <int BITS>
+    static void DescribeBox(const uint32_t* center, int step, const int* off0, const int* off1, uchar* descriptor);
+
+    /** per bit reference of DescribeBox */
+    template <int BITS>
+    static void DescribeBoxScalar(const uint32_t* center, int step, const int* off0, const int* off1,
+                                  uchar* descriptor);
+};
+
+#endif //ORBEXTRACTOR_BRIEF_H
@@ -0,0 +1,99 @@
+#ifndef ORBEXTRACTOR_BUFFERALLOCATOR_H
+#define ORBEXTRACTOR_BUFFERALLOCATOR_H
+
+#include <cstddef>
+#include <opencv2/core/core.hpp>
+
+
+class BufferAllocator
+{
+public:
+
+    enum PageMode
+    {
+        REGULAR_PAGES = 0,
+        TRANSPARENT_HUGE_PAGES = 1,
+        EXPLICIT_HUGE_PAGES = 2
+    };
+
+    /** Owns one allocation, cv::Mat headers created by BufferAllocator::Create point into it */
+    class Block
+    {
+    public:
+        Block() : data(nullptr), size(0), mapBase(nullptr), mapSize(0), mode(REGULAR_PAGES) {}
+
+        ~Block()
+        {
+            Release();
+        }
+
+        Block(Block &&other) noexcept;
+
+        Block& operator=(Block &&other) noexcept;
+
+        Block(const Block &other) = delete;
+
+        Block& operator=(const Block &other) = delete;
+
+        void Release();
+
+        /** whether the memory is backed by 2MB pages (explicit) or advised to be (transparent) */
+        PageMode inline GetGrantedMode() const
+        {
+            return granted;
+        }
+
+    private:
+        friend class BufferAllocator;
+
+        uchar* data;
+        size_t size;
+        void* mapBase;
+        size_t mapSize;
+        PageMode mode;
+        PageMode granted = REGULAR_PAGES;
+    };
+
+    BufferAllocator() : pageMode(REGULAR_PAGES), firstTouch(false) {}
+
+    void inline SetPageMode(PageMode mode)
+    {
+        pageMode = mode;
+    }
+
+    PageMode inline GetPageMode() const
+    {
+        return pageMode;
+    }
+
+    /**
+     * If enabled, new blocks are written once by the thread calling Create, so that their pages are placed on
+     * the NUMA node of that thread. Create should then be called from the thread that processes the buffer.
+     */
+    void inline SetFirstTouch(bool b)
+    {
+        firstTouch = b;
+    }
+
+    bool inline GetFirstTouch() const
+    {
+        return firstTouch;
+    }
+
+    /**
+     * Points mat at a continuous rows x cols buffer of the given type inside block. The block is only
+     * reallocated if it is too small or was allocated with another page mode. Explicit huge pages fall back to
+     * transparent huge pages, those fall back to regular 64 byte aligned heap memory.
+     * @return true if the block was reallocated, previous contents are lost then
+     */
+    bool Create(cv::Mat &mat, int rows, int cols, int type, Block &block) const;
+
+protected:
+
+    static void Allocate(Block &block, size_t bytes, PageMode mode);
+
+    PageMode pageMode;
+    bool firstTouch;
+};
+
+#endif //ORBEXTRACTOR_BUFFERALLOCATOR_H
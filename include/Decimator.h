@@ -0,0 +1,23 @@
+#ifndef ORBEXTRACTOR_DECIMATOR_H
+#define ORBEXTRACTOR_DECIMATOR_H
+
+#include <opencv2/core/core.hpp>
+
+
+class Decimator
+{
+public:
+
+    /**
+     * Exact 2x2 box decimation, dst(x, y) = (sum of src(2x..2x+1, 2y..2y+1) + 2) >> 2.
+     * @param src 8-bit gray, may be a ROI
+     * @param dst must have size (src.cols/2, src.rows/2), may be a ROI
+     */
+    static void Box2x(const cv::Mat &src, cv::Mat &dst);
+
+protected:
+
+    static void Box2xRow(const uchar* row0, const uchar* row1, uchar* dst, int width);
+};
+
+#endif //ORBEXTRACTOR_DECIMATOR_H
@@ -0,0 +1,73 @@
+#ifndef ORBEXTRACTOR_DESCRIPTORCACHE_H
+#define ORBEXTRACTOR_DESCRIPTORCACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "include/Types.h"
+
+
+/**
+ * Descriptors of the previous frame keyed on (octave, pixel in level coordinates, quantised angle), each with a
+ * signature of its blurred patch. A keypoint of the current frame reuses the descriptor stored under its key if
+ * its own signature deviates by at most the tolerance in every sample. Reused descriptors keep the signature
+ * of the frame they were computed in, so a slowly changing patch is redescribed once the drift exceeds it.
+ */
+class DescriptorCache
+{
+public:
+
+    /** 4x4 blurred pixels spaced 8 pixels apart around the keypoint, inside the BRIEF footprint */
+    static const int SIGNATURE_SIZE = 16;
+
+    struct Stats
+    {
+        int keypoints;
+        int hits;
+        float hitRatio;
+        /** hits times the average time of a computed descriptor in the same frame */
+        double savedMicroseconds;
+    };
+
+    explicit DescriptorCache(float angleQuantum = 12.f, int signatureTolerance = 2);
+
+    void SetTolerances(float angleQuantum, int signatureTolerance);
+
+    void Clear();
+
+    /** @param kpt keypoint in level coordinates, octave set */
+    uint64_t Key(const knuff::KeyPoint &kpt) const;
+
+    /** @param center keypoint pixel of a blurred level with at least 12 pixels of valid surrounding */
+    static void Signature(const uchar* center, int step, uchar* signature);
+
+    /**
+     * Copies the stored descriptor of key if signature is within tolerance of the stored one, which then
+     * replaces signature.
+     */
+    bool Lookup(uint64_t key, uchar* signature, uchar* descriptor) const;
+
+    /**
+     * Replaces the entries by those of the current frame, keypoint i with keys[i], SIGNATURE_SIZE bytes at
+     * signatures[i*SIGNATURE_SIZE] and descriptor row rows[i] (i if rows is null). Records the frame stats.
+     */
+    void Update(const std::vector<uint64_t> &keys, const std::vector<uchar> &signatures,
+                const cv::Mat &descriptors, const std::vector<int>* rows, int hits, double describeMicroseconds);
+
+    Stats inline GetStats() const
+    {
+        return stats;
+    }
+
+private:
+    float angleQuantum;
+    int angleBins;
+    int tolerance;
+    std::unordered_map<uint64_t, int> entries;
+    std::vector<uchar> signatures;
+    cv::Mat descriptors;
+    Stats stats;
+};
+
+#endif //ORBEXTRACTOR_DESCRIPTORCACHE_H
@@ -0,0 +1,56 @@
+#ifndef ORBEXTRACTOR_DESCRIPTORSTORE_H
+#define ORBEXTRACTOR_DESCRIPTORSTORE_H
+
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include "include/BufferAllocator.h"
+
+
+/**
+ * Packed 256 bit descriptors in rows of 32 bytes starting at a 64 byte aligned address, so every row can be read
+ * with one aligned 32 byte load or as 4 64 bit words.
+ */
+class DescriptorStore
+{
+public:
+
+    static const int ROW_BYTES = 32;
+    static const int ROW_WORDS = ROW_BYTES / 8;
+
+    DescriptorStore() : rows(0) {}
+
+    /** @param descriptors CV_8U with ROW_BYTES columns, e.g. the output of ORBextractor */
+    explicit DescriptorStore(const cv::Mat &descriptors);
+
+    /** copies descriptors into the store, reusing its memory if large enough */
+    void Assign(const cv::Mat &descriptors);
+
+    int inline Size() const
+    {
+        return rows;
+    }
+
+    inline const uchar* Row(int i) const
+    {
+        return mat.ptr<uchar>(i);
+    }
+
+    inline const uint64_t* Words(int i) const
+    {
+        return mat.ptr<uint64_t>(i);
+    }
+
+    /** header onto the store without copying */
+    inline const cv::Mat& AsMat() const
+    {
+        return mat;
+    }
+
+private:
+    BufferAllocator allocator;
+    BufferAllocator::Block block;
+    cv::Mat mat;
+    int rows;
+};
+
+#endif //ORBEXTRACTOR_DESCRIPTORSTORE_H
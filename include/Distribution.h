@@ -38,7 +38,8 @@ public:
         SSC = 6,
         KEEP_ALL = 7,
         SOFT_SSC = 8,
-        VSSC = 9
+        VSSC = 9,
+        ANMS_EXACT = 10
     };
 
     static void DistributeKeypoints(std::vector<knuff::KeyPoint> &kpts, int minX, int maxX, int minY,
@@ -71,6 +72,13 @@ protected:
 
     static void DistributeKeypointsVSSC(std::vector<knuff::KeyPoint> &kpts, int minX, int maxX, int minY, int maxY,
             int N, float epsilon, float threshold);
+
+    /**
+     * ANMS without a width search: the suppression radius of every keypoint (distance to the nearest stronger one,
+     * ties broken by input order) is computed exactly in one pass over a uniform grid that is filled in response
+     * order, then the N keypoints with the largest radii are kept, ordered by response.
+     */
+    static void DistributeKeypointsExactANMS(std::vector<knuff::KeyPoint> &kpts, int N);
 };
 
 CV_INLINE  int myRound( float value )
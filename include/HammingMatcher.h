@@ -0,0 +1,45 @@
+#ifndef ORBEXTRACTOR_HAMMINGMATCHER_H
+#define ORBEXTRACTOR_HAMMINGMATCHER_H
+
+#include <vector>
+#include "include/DescriptorStore.h"
+
+
+/**
+ * Brute force Hamming matching of 256 bit descriptors. Every query is compared against 4 train rows at a time,
+ * counting bits with AVX-512 VPOPCNTDQ if available, else with the AVX2 nibble lookup table, else with scalar
+ * popcount. Queries are matched in parallel with OpenMP.
+ */
+class HammingMatcher
+{
+public:
+
+    struct Match
+    {
+        int query;
+        int train;
+        int distance;
+        /** distance of the second best train row, 257 if there is none */
+        int secondDistance;
+    };
+
+    static const int NO_DISTANCE = 257;
+
+    static int Distance(const uint64_t* a, const uint64_t* b);
+
+    /** distances of a to b0..b3, all 32 byte aligned */
+    static void Distance4(const uint64_t* a, const uint64_t* b0, const uint64_t* b1, const uint64_t* b2,
+                          const uint64_t* b3, int* distances);
+
+    /** best and second best train row of every query, best[i].query == i, train -1 if train is empty */
+    static void KnnMatch2(const DescriptorStore &query, const DescriptorStore &train, std::vector<Match> &best);
+
+    /**
+     * Matches passing the ratio test (distance < ratio * secondDistance) and maxDistance, ordered by query.
+     * With crossCheck the query also has to be the best match of its train row.
+     */
+    static void RatioMatch(const DescriptorStore &query, const DescriptorStore &train, std::vector<Match> &matches,
+                           float ratio = 0.8f, bool crossCheck = true, int maxDistance = 256);
+};
+
+#endif //ORBEXTRACTOR_HAMMINGMATCHER_H
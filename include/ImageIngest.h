@@ -0,0 +1,95 @@
+#ifndef ORBEXTRACTOR_IMAGEINGEST_H
+#define ORBEXTRACTOR_IMAGEINGEST_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+class ImageIngest
+{
+public:
+
+    enum InputFormat
+    {
+        AUTO = 0,
+        GRAY = 1,
+        BGR = 2,
+        RGB = 3,
+        BGRA = 4,
+        BAYER_RGGB = 5,
+        BAYER_GRBG = 6
+    };
+
+    /** AUTO resolves to GRAY, BGR or BGRA depending on the number of channels */
+    static InputFormat ResolveFormat(InputFormat format, int channels);
+
+    static bool inline IsBayer(InputFormat format)
+    {
+        return format == BAYER_RGGB || format == BAYER_GRBG;
+    }
+
+    /**
+     * Converts src to 8-bit gray and writes the result into dst, which must already have the right size
+     * (it may be a ROI, e.g. the interior of a bordered pyramid level). Uses the BT.601 weights of
+     * cv::cvtColor with identical fixed point rounding.
+     * @param greenHalfResolution only for bayer input: dst is the (cols/2 x rows/2) average of the two green
+     * samples of every 2x2 cell instead of a full resolution demosaiced gray image
+     * @param firstRow, lastRow range of dst rows to write, lastRow = -1 means dst.rows
+     */
+    static void ToGray(const cv::Mat &src, cv::Mat &dst, InputFormat format, bool greenHalfResolution = false,
+                       int firstRow = 0, int lastRow = -1);
+
+    static cv::Size OutputSize(const cv::Mat &src, InputFormat format, bool greenHalfResolution);
+
+    /**
+     * Fixed point bilinear remap table: per output pixel the offset of the top left source pixel and the x/y
+     * weights of 5 fractional bits (0..32), each in a 6 bit field, packed as fx | fy << 6. Source coordinates
+     * are clamped to the image.
+     */
+    struct RemapLUT
+    {
+        std::vector<int> offsets;
+        std::vector<ushort> weights;
+        std::vector<uchar> scalarRows;
+        cv::Size size;
+        int srcStep = -1;
+
+        bool inline Matches(cv::Size sz, int step) const
+        {
+            return sz == size && step == srcStep;
+        }
+    };
+
+    /**
+     * Computes the undistortion/rectification table with the pinhole + radial-tangential model of
+     * cv::initUndistortRectifyMap.
+     * @param K 3x3 camera matrix
+     * @param distCoeffs k1, k2, p1, p2[, k3], empty if already undistorted
+     * @param R 3x3 rectifying rotation, identity if empty
+     * @param P 3x3 or 3x4 new camera matrix, K if empty
+     * @param size size of source and destination image
+     * @param srcStep row stride of the source image in bytes
+     */
+    static void BuildUndistortionLUT(const cv::Mat &K, const cv::Mat &distCoeffs, const cv::Mat &R,
+                                     const cv::Mat &P, cv::Size size, int srcStep, RemapLUT &lut);
+
+    /**
+     * @param dst may be a ROI, must have lut.size
+     * @param firstRow, lastRow range of dst rows to write, lastRow = -1 means dst.rows
+     */
+    static void Remap(const cv::Mat &src, cv::Mat &dst, const RemapLUT &lut, int firstRow = 0, int lastRow = -1);
+
+protected:
+
+    static void ColorRowToGray(const uchar* src, uchar* dst, int width, int channels, bool rgbOrder);
+
+    static void BayerRowToGray(const uchar* up, const uchar* mid, const uchar* down, uchar* dst, int width,
+                               bool redRow, bool colorAtEven);
+
+    static void BayerRowsToGreen(const uchar* row0, const uchar* row1, uchar* dst, int width, bool greenFirst);
+
+    static void RemapRow(const uchar* src, uchar* dst, const int* offsets, const ushort* weights, int srcStep,
+                         int width, bool scalarOnly);
+};
+
+#endif //ORBEXTRACTOR_IMAGEINGEST_H
@@ -0,0 +1,59 @@
+#ifndef ORBEXTRACTOR_MAPPEDFILE_H
+#define ORBEXTRACTOR_MAPPEDFILE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+/**
+ * Read-only memory mapping of a whole file, for binary files whose sections start at multiples of ALIGNMENT
+ * bytes, so arrays can be used in place without parsing.
+ */
+class MappedFile
+{
+public:
+
+    static const size_t ALIGNMENT = 64;
+
+    MappedFile() : data(nullptr), size(0) {}
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile &other) = delete;
+
+    MappedFile& operator=(const MappedFile &other) = delete;
+
+    /** @return false if the file cannot be opened or mapped */
+    bool Open(const std::string &filename);
+
+    void Close();
+
+    inline const uchar* Data() const
+    {
+        return data;
+    }
+
+    size_t inline Size() const
+    {
+        return size;
+    }
+
+    static size_t inline Padded(size_t bytes)
+    {
+        return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    /** writes every (data, bytes) section zero padded to a multiple of ALIGNMENT bytes */
+    static bool Write(const std::string &filename, const std::vector<std::pair<const void*, size_t>> &sections);
+
+private:
+    uchar* data;
+    size_t size;
+};
+
+#endif //ORBEXTRACTOR_MAPPEDFILE_H
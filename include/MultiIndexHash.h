@@ -0,0 +1,129 @@
+#ifndef ORBEXTRACTOR_MULTIINDEXHASH_H
+#define ORBEXTRACTOR_MULTIINDEXHASH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "include/DescriptorStore.h"
+#include "include/MappedFile.h"
+
+
+/**
+ * Multi-index hashing (Norouzi et al.) over 256 bit descriptors: every descriptor is split into SUBSTRINGS
+ * 16 bit substrings, each indexing its own table of 2^16 buckets. Two descriptors within distance d agree up to
+ * floor(d/SUBSTRINGS) bits in at least one substring, so probing all buckets within substring radius s of a
+ * query finds every descriptor within distance SUBSTRINGS*(s+1)-1. Queries widen s until that covers the
+ * k-th neighbour or the radius, and fall back to a linear scan once the probed buckets and candidates, weighted by
+ * RANDOM_ACCESS_COST, would cost more than it.
+ *
+ * Tables are stored as bucket offsets and descriptor ids (compressed sparse rows), so an index can be saved
+ * to one file and mapped back into memory without parsing.
+ */
+class MultiIndexHash
+{
+public:
+
+    static const int SUBSTRINGS = 16;
+    static const int BUCKETS = 1 << 16;
+
+    /** cost of a probed bucket or candidate relative to a descriptor of a linear scan, mostly cache misses */
+    static const int RANDOM_ACCESS_COST = 32;
+
+    struct Neighbour
+    {
+        uint32_t id;
+        int distance;
+    };
+
+    MultiIndexHash();
+
+    ~MultiIndexHash();
+
+    MultiIndexHash(const MultiIndexHash &other) = delete;
+
+    MultiIndexHash& operator=(const MultiIndexHash &other) = delete;
+
+    /**
+     * Indexes the rows of descriptors, building the tables in parallel.
+     * @param frameStart first row of every frame followed by the number of rows, empty for a single frame
+     */
+    void Build(const cv::Mat &descriptors, const std::vector<uint64_t> &frameStart = std::vector<uint64_t>());
+
+    /**
+     * Indexes all frames saved by FeatureFileInterface under path (frames 0, 1, ... until one is missing).
+     * @return false if no frame was found
+     */
+    bool BuildFromSequence(std::string path);
+
+    bool Save(const std::string &filename) const;
+
+    /** maps an index written by Save read-only into memory, false if the file is missing or invalid */
+    bool Load(const std::string &filename);
+
+    uint64_t inline Size() const
+    {
+        return n;
+    }
+
+    uint64_t inline GetFrameCount() const
+    {
+        return nframes;
+    }
+
+    /** frame a descriptor id belongs to */
+    uint64_t Frame(uint32_t id) const;
+
+    inline const uint64_t* Descriptor(uint32_t id) const
+    {
+        return descriptors + (size_t)id * DescriptorStore::ROW_WORDS;
+    }
+
+    /** k nearest neighbours of every query ordered by distance and id, queries are processed in parallel */
+    void KnnSearch(const DescriptorStore &queries, int k, std::vector<std::vector<Neighbour>> &results) const;
+
+    /** all neighbours within radius of every query ordered by distance and id */
+    void RadiusSearch(const DescriptorStore &queries, int radius,
+                      std::vector<std::vector<Neighbour>> &results) const;
+
+protected:
+
+    /** per thread bitset of visited ids and the words touched in it */
+    struct Scratch
+    {
+        std::vector<uint64_t> visited;
+        std::vector<uint32_t> touched;
+        uint64_t candidates = 0;
+    };
+
+    void Knn(const uint64_t* query, int k, Scratch &scratch, std::vector<Neighbour> &result) const;
+
+    void Radius(const uint64_t* query, int radius, Scratch &scratch, std::vector<Neighbour> &result) const;
+
+    /**
+     * Calls visit(id) once for every not yet visited id in the buckets at substring radius s of query, or for
+     * every remaining id if a linear scan is cheaper, see RANDOM_ACCESS_COST.
+     * @return true if all ids have been visited
+     */
+    template <typename Visit>
+    bool Probe(const uint64_t* query, int s, Scratch &scratch, Visit visit) const;
+
+    void Release();
+
+    uint64_t n;
+    uint64_t nframes;
+    // views onto either the owned vectors or the mapped file
+    const uint64_t* descriptors;
+    const uint64_t* frameStart;
+    const uint32_t* offsets;
+    const uint32_t* ids;
+
+    std::vector<uint64_t> ownedDescriptors;
+    std::vector<uint64_t> ownedFrameStart;
+    std::vector<uint32_t> ownedOffsets;
+    std::vector<uint32_t> ownedIds;
+
+    MappedFile mapped;
+};
+
+#endif //ORBEXTRACTOR_MULTIINDEXHASH_H
@@ -271,5 +271,77 @@ static int bit_pattern_31_[256*4] =
                 7,0, 12,-2/*mean (0.127002), correlation (0.537452)*/,
                 -1,-6, 0,-11/*mean (0.127148), correlation (0.547401)*/
         };
+
+/**
+ * 256 further tests for 512 bit descriptors, following bit_pattern_31_. Not learned like those, but drawn from an
+ * isotropic Gaussian with sigma = PATCH_SIZE/5 (BRIEF's G II sampling) and clipped to the same +-13 pixels.
+ */
+static int bit_pattern_31_extension_[256*4] =
+        {
+                -3,-4, 10,-3, 4,-4, 5,-1, -4,3, 3,-2, -5,1, -4,-2,
+                4,-4, 4,-8, 1,4, 3,-1, -4,-5, 8,-11, 3,7, 1,-2,
+                3,0, 3,-3, 7,2, -3,-5, -9,5, -5,3, 6,-6, -1,0,
+                -5,-1, -10,0, 1,3, 0,0, -1,11, 9,4, -2,1, -4,1,
+                1,1, -6,9, -1,4, 7,1, -6,-8, 0,4, 12,-4, 4,-5,
+                11,1, 6,-1, -3,-3, -7,-8, -6,6, 3,1, 8,1, -3,8,
+                2,-2, 7,-5, -6,9, 4,-1, 2,0, -7,0, -4,-5, -2,3,
+                13,6, 5,6, 10,1, -8,7, 1,9, 5,9, 1,11, 3,-3,
+                7,2, 2,1, -7,10, -3,0, 7,-3, -1,0, -4,13, -6,-4,
+                0,0, 4,-12, 1,6, -5,-1, 3,0, -6,3, -5,0, 1,-6,
+                -8,3, 1,-2, 6,13, 1,10, -5,-8, 1,6, 3,-3, 2,2,
+                10,-11, -7,2, 7,2, 9,1, 1,1, -8,2, 3,0, 4,10,
+                -3,1, -2,-8, 5,6, -8,-6, -5,-2, 1,3, 1,1, 2,13,
+                2,-5, -1,7, 1,4, 2,5, 4,1, -6,1, -8,-4, 4,0,
+                5,4, 5,-4, -5,0, 5,-8, 5,-3, -1,5, 6,5, -10,-3,
+                -12,4, -6,4, 3,-3, -1,-5, 0,-12, -3,-4, -4,0, 3,4,
+                -5,3, 0,4, 1,-4, 2,4, -1,10, 1,5, 9,8, 3,-6,
+                -5,-2, 12,-3, -2,1, 2,12, -7,12, -4,3, 7,10, -2,8,
+                -2,7, 5,-13, 8,-1, -4,11, -3,7, -4,-6, -2,9, 3,-3,
+                10,3, -12,-1, -4,13, -11,-1, 8,-4, -1,-1, -5,-5, -7,-1,
+                3,7, 9,-3, 6,2, -8,6, -6,-3, -5,3, -4,-5, -2,-7,
+                -5,-4, 0,7, -1,0, 0,-1, 8,-2, 4,-8, 1,1, 8,1,
+                9,4, -4,-6, 4,-1, 0,3, 3,-3, -7,-9, -8,-2, 1,-12,
+                -10,2, -4,-7, -3,6, -5,-6, 1,2, 5,-7, 9,0, -5,-12,
+                13,1, 5,-6, 8,-1, -4,-1, -1,0, -5,4, 1,8, 8,9,
+                2,-3, -3,10, 5,-7, 0,2, -2,6, 3,9, 2,-3, 2,2,
+                -3,-4, 3,10, -2,-3, 2,8, -8,-1, -2,2, -2,-1, -12,6,
+                1,1, 0,-4, 6,-10, -3,-1, 1,-8, 11,5, 2,0, 4,2,
+                -1,12, 4,2, -4,-9, -2,-2, -9,-10, 6,2, -9,-7, 3,6,
+                5,12, -3,3, 5,3, -2,-1, 4,-10, -2,10, 10,9, -4,-3,
+                1,-5, -6,-12, 8,2, -2,-5, 1,5, -8,13, 1,-2, -4,4,
+                1,-10, -3,-9, 4,-3, 7,9, 5,5, -4,2, -1,9, 1,6,
+                3,-10, 9,10, 6,-9, 2,-1, -5,-1, -11,-3, -1,-3, -5,9,
+                -1,1, -8,2, 2,-9, 1,-2, -9,-11, 6,-1, -6,13, 2,2,
+                1,-2, -9,6, 4,4, 0,-11, -8,-6, -10,-7, 0,2, -3,-6,
+                -1,10, 12,-2, -8,8, 3,5, -1,-5, -1,2, -2,3, 9,-4,
+                0,4, -4,-2, 0,-5, -10,3, 9,-1, 2,-2, 1,8, 3,-5,
+                5,2, 9,7, 1,4, 11,-1, -4,-5, -7,1, 6,-2, 4,2,
+                2,-1, 8,-3, -6,4, -11,-4, -10,3, -9,-6, -1,-4, 3,-4,
+                -2,1, 2,2, 1,-5, -2,2, 8,-5, -2,-13, -9,-6, 4,-4,
+                -5,4, 4,-9, -5,1, -9,6, 0,-4, -2,-1, 3,0, -6,-7,
+                12,0, 5,0, 9,-9, -1,-7, -3,7, -1,10, 2,-1, -6,2,
+                5,-8, 7,0, -8,1, 4,-1, -3,-1, -7,-4, -1,4, -1,2,
+                3,-6, 8,1, -1,4, 0,5, -6,1, 2,-8, 2,-6, 7,-4,
+                1,-5, 3,3, -6,0, -1,8, 2,6, -7,1, -9,7, -5,1,
+                -4,-2, 8,1, 1,5, -7,-5, -12,-3, -1,-1, 0,1, -6,6,
+                -1,-5, -3,-5, 1,-8, -1,-6, -1,-3, -7,-1, 10,4, -13,0,
+                5,-6, 0,-13, 2,-2, -5,-2, -10,2, -8,2, -7,-5, 9,-9,
+                4,3, 7,9, 3,-4, 7,-4, -9,1, -3,3, -6,-9, -3,0,
+                -5,0, 1,-2, -3,-6, 7,-4, -7,-3, 4,0, 4,-4, -3,-1,
+                -3,-3, -3,0, 2,7, -3,11, 5,-10, 12,2, 6,-6, -4,-2,
+                0,-7, -2,-3, 7,6, -2,-11, 3,-5, 7,-2, -1,6, -8,-2,
+                9,-5, -2,9, -1,2, 0,6, -2,-2, 1,10, 4,9, 8,11,
+                -3,11, -1,0, -4,-2, 7,6, -7,-3, 11,-5, 7,7, -4,11,
+                3,-1, -4,7, 1,0, -6,-10, -2,-6, 2,-3, 4,-6, 7,4,
+                12,-11, -3,5, 3,-5, 0,-7, 5,-7, 3,1, 4,11, -2,-3,
+                -3,0, 6,-2, -3,9, 5,3, 7,-2, 6,4, 0,3, -5,-6,
+                5,3, -7,6, -3,10, -2,5, -5,13, 0,1, 1,3, -6,6,
+                -4,6, -3,2, -6,1, 5,-5, -4,-3, -1,2, -8,3, -2,-6,
+                1,1, -5,-5, 3,-1, -1,-12, -7,-11, -1,7, 7,6, 0,-2,
+                -9,11, 5,-7, 8,-5, 0,4, -8,6, 9,-9, 1,-10, -1,11,
+                -7,-5, 7,-1, 0,-1, 3,-2, 2,-2, -5,-8, -5,-7, 1,-1,
+                5,5, -2,0, 8,-5, 11,-7, 4,0, 5,7, 3,13, 11,-3,
+                7,5, -4,-3, 8,-3, 8,5, 0,-2, 2,2, -8,3, -6,2
+        };
 }
 #endif //ORBEXTRACTOR_ORBCONSTANTS_H
@@ -5,6 +5,13 @@
 #include "include/Distribution.h"
 #include "include/FAST.h"
 #include "include/FeatureFileInterface.h"
+#include "include/ImageIngest.h"
+#include "include/PyramidBlur.h"
+#include "include/Decimator.h"
+#include "include/BufferAllocator.h"
+#include "include/Orientation.h"
+#include "include/BRIEF.h"
+#include "include/DescriptorCache.h"
 
 #ifndef NDEBUG
 #   define D(x) x
@@ -20,11 +27,51 @@ class ORBextractor
 {
 public:
 
+    /** @param descriptorBits 128, 256 (ORB) or 512, descriptors have descriptorBits/8 byte rows */
     ORBextractor(int nfeatures, float scaleFactor, int nlevels,
-                 int iniThFAST, int minThFAST);
+                 int iniThFAST, int minThFAST, int descriptorBits = 256);
 
     ~ORBextractor() = default;
 
+    /**
+     * Keypoints of a detection-only call (see Detect) whose descriptors, and angles if they were skipped, are
+     * computed on demand. Refers to the pyramid of its extractor, so it is valid until released or until the
+     * extractor processes the next image.
+     */
+    class LazyFrame
+    {
+    public:
+        LazyFrame() : extractor(nullptr), id(0) {}
+
+        /** keypoints in pixel coordinates of the input, negative angles are not computed yet */
+        inline const std::vector<knuff::KeyPoint>& GetKeypoints() const
+        {
+            return keypoints;
+        }
+
+        bool inline IsValid() const
+        {
+            return extractor && extractor->frameId == id;
+        }
+
+        /** @param indices into GetKeypoints(), descriptor row i belongs to indices[i] */
+        void Describe(const std::vector<int> &indices, cv::OutputArray descriptors);
+
+        void Release();
+
+    private:
+        friend class ORBextractor;
+
+        ORBextractor* extractor;
+        unsigned long id;
+        std::vector<knuff::KeyPoint> keypoints;
+        std::vector<std::vector<knuff::KeyPoint>> levelKpts;
+        // level and position in levelKpts of every keypoint
+        std::vector<std::pair<int, int>> levelIndex;
+        std::vector<uchar> fullyBlurred;
+        std::vector<uchar> blurPrepared;
+    };
+
 
     void operator()( cv::InputArray image, cv::InputArray mask,
                      std::vector<knuff::KeyPoint>& keypoints,
@@ -34,6 +81,12 @@ public:
                                   std::vector<knuff::KeyPoint> &resultKeypoints, cv::OutputArray outputDescriptors,
                                   bool distributePerLevel = true);
 
+    void Detect(cv::InputArray inputImage, cv::InputArray mask, LazyFrame &frame, bool distributePerLevel = true,
+                bool computeAngles = false);
+
+    void DescribeKeypoints(cv::InputArray inputImage, std::vector<knuff::KeyPoint> &keypoints,
+                           cv::OutputArray outputDescriptors);
+
     int inline GetLevels(){
         return nlevels;}
 
@@ -66,6 +119,107 @@ public:
         return kptDistribution;
     }
 
+    /**
+     * FULL blurs every level while FAST runs, SPARSE blurs only the BRIEF footprints of the final keypoints
+     * afterwards. AUTO decides per level, see PyramidBlur::PreferSparse.
+     */
+    void inline SetBlurMode(PyramidBlur::Mode mode)
+    {
+        blurMode = mode;
+    }
+
+    PyramidBlur::Mode inline GetBlurMode()
+    {
+        return blurMode;
+    }
+
+    /** length of the descriptors set at construction, 128, 256 or 512 */
+    int inline GetDescriptorBits() const
+    {
+        return descriptorBits;
+    }
+
+    /** columns of the descriptor Mat, GetDescriptorBits()/8 */
+    int inline GetDescriptorBytes() const
+    {
+        return descriptorBits / 8;
+    }
+
+    /**
+     * If enabled (default), the pattern footprint of the next keypoint is prefetched while a descriptor is
+     * computed, see BRIEF::PrefetchFootprint. Descriptors are the same either way.
+     */
+    void inline EnableFootprintPrefetch(bool b)
+    {
+        prefetchFootprints = b;
+    }
+
+    /**
+     * GAUSSIAN describes keypoints on the 7x7 Gaussian blurred levels (see SetBlurMode), BOX on 5x5 box sums from
+     * one integral image per level, which is built instead of the blurred pyramid, see BRIEF::Smoothing. Both
+     * produce different descriptors, so only match descriptors of the same mode. BOX bypasses the descriptor cache.
+     */
+    void inline SetDescriptorSmoothing(BRIEF::Smoothing smoothing)
+    {
+        descriptorSmoothing = smoothing;
+    }
+
+    BRIEF::Smoothing inline GetDescriptorSmoothing()
+    {
+        return descriptorSmoothing;
+    }
+
+    /**
+     * SIMD computes the intensity centroid moments with AVX2 and the angles with a vector atan2 whose deviation
+     * from the SCALAR angles (cv::fastAtan2) stays within tolerance degrees, see Orientation::PolynomialDegree.
+     * Levels dense enough in keypoints switch to moments from row prefix sums in both modes, see
+     * Orientation::PreferPrefixSums, PREFIX_SUM forces that for every level with keypoints. Moments are exact in
+     * all methods.
+     */
+    void inline SetOrientationMethod(Orientation::Method method, float tolerance = 0.001f)
+    {
+        orientationMethod = method;
+        orientationTolerance = tolerance;
+    }
+
+    Orientation::Method inline GetOrientationMethod()
+    {
+        return orientationMethod;
+    }
+
+    /**
+     * n > 0 quantises orientations to n bins, keypoint angles become the bin centers. Bins are chosen from the
+     * moments without atan2 and BRIEF reads per level and bin offset tables, rebuilt in SetSteps whenever level
+     * strides change, instead of rotating the pattern per keypoint. 0 disables.
+     */
+    void inline SetOrientationBins(int n)
+    {
+        orientationBins = Orientation::Bins(std::max(n, 0));
+        stepsChanged = true;
+    }
+
+    int inline GetOrientationBins()
+    {
+        return orientationBins.Count();
+    }
+
+    /**
+     * If enabled, operator() reuses the descriptor of the previous frame for keypoints that reappear at the same
+     * level, pixel and orientation (quantised to angleQuantum degrees) while no signature sample of their blurred
+     * patch changed by more than signatureTolerance, see DescriptorCache. Reused descriptors are approximate.
+     */
+    void inline EnableDescriptorCache(bool b, float angleQuantum = 12.f, int signatureTolerance = 2)
+    {
+        useDescriptorCache = b;
+        descriptorCache.SetTolerances(angleQuantum, signatureTolerance);
+    }
+
+    /** hit ratio and estimated time saved by the descriptor cache in the last frame */
+    DescriptorCache::Stats inline GetDescriptorCacheStats()
+    {
+        return descriptorCache.GetStats();
+    }
+
     void inline SetScoreType(FASTdetector::ScoreType s)
     {
         fast.SetScoreType(std::forward<FASTdetector::ScoreType >(s));
@@ -120,6 +274,96 @@ public:
     {
         return timeVector;
     }
+    /**
+     * If enabled and the input image is a ROI with at least EDGE_THRESHOLD pixels of padding on every side
+     * inside its parent buffer, level 0 of the pyramid wraps the input directly instead of copying it.
+     * The padding of the caller's buffer is overwritten with the reflected border.
+     */
+    void inline EnablePaddedInputWrapping(bool b)
+    {
+        wrapPaddedInput = b;
+    }
+
+    /**
+     * If enabled, octave anchors (level 0 decimated by powers of two with an exact box filter) are built and
+     * the first level of every octave is interpolated from its anchor instead of from its predecessor, so
+     * bilinear passes do not compound across octaves. Levels within an octave are still chained. Level sizes and
+     * scaleFactorVec are the same in both modes, keypoints of levels above the first octave differ, see
+     * RunPyramidComparison in benchmark.cpp. With scale factors that stay below 2 both modes are identical.
+     */
+    void inline EnableOctaveAnchoredPyramid(bool b)
+    {
+        octaveAnchoredPyramid = b;
+    }
+
+    /**
+     * If enabled, level 0 is produced, bordered, searched with FAST and blurred in horizontal bands that fit
+     * into the L2 cache instead of in separate passes over the whole image. Output is identical.
+     * @param rows rows per band, 0 derives it from the L2 cache size
+     */
+    void inline EnableStripedLevel0(bool b, int rows = 0)
+    {
+        stripedLevel0 = b;
+        stripeRows = rows;
+    }
+
+    /**
+     * Page mode of the bordered pyramid, blurred pyramid, octave anchor and ingest buffers, see BufferAllocator.
+     * Buffers are reallocated with the new mode on the next frame.
+     */
+    void inline SetBufferPageMode(BufferAllocator::PageMode mode)
+    {
+        bufferAllocator.SetPageMode(mode);
+    }
+
+    /**
+     * If enabled, newly allocated pyramid levels are first written by the thread that runs FAST on them, and
+     * blurred levels by the thread that blurs them, so their pages are placed on that thread's NUMA node.
+     */
+    void inline EnableFirstTouchPlacement(bool b)
+    {
+        bufferAllocator.SetFirstTouch(b);
+    }
+
+    /**
+     * Colour and bayer images are converted while they are written into level 0 of the pyramid.
+     * AUTO treats 1/3/4 channel input as gray/BGR/BGRA, RGB and bayer input have to be set explicitly.
+     */
+    void inline SetInputFormat(ImageIngest::InputFormat f)
+    {
+        inputFormat = f;
+    }
+
+    ImageIngest::InputFormat inline GetInputFormat()
+    {
+        return inputFormat;
+    }
+
+    /**
+     * If enabled, bayer input is reduced to its green channel at half resolution and detection runs on that.
+     * Returned keypoints are mapped back to full resolution pixel coordinates.
+     */
+    void inline EnableBayerGreenHalfResolution(bool b)
+    {
+        bayerGreenHalfResolution = b;
+    }
+
+    /**
+     * Enables undistortion/rectification of the input while it is written into level 0, so keypoints are
+     * returned in rectified pixel coordinates. Arguments follow cv::initUndistortRectifyMap, the output image
+     * has the size of the input. The fixed point remap table is built on the first frame of each resolution.
+     * @param K camera matrix of the input
+     * @param distCoeffs k1, k2, p1, p2[, k3]
+     * @param R rectifying rotation, identity if empty
+     * @param P new camera matrix (3x3 or 3x4), K if empty
+     */
+    void SetCameraCalibration(const cv::Mat &K, const cv::Mat &distCoeffs, const cv::Mat &R = cv::Mat(),
+                              const cv::Mat &P = cv::Mat());
+
+    void inline DisableUndistortion()
+    {
+        undistortInput = false;
+    }
 
     void SetSteps();
 
@@ -130,25 +374,111 @@ protected:
 
     void ComputeAngles(std::vector<std::vector<knuff::KeyPoint>> &allkpts);
 
-    void ComputeDescriptors(std::vector<std::vector<knuff::KeyPoint>> &allkpts, cv::Mat &descriptors);
+    void ComputeDescriptors(std::vector<std::vector<knuff::KeyPoint>> &allkpts, cv::Mat &descriptors,
+                            const std::vector<int>* rows = nullptr, DescriptorCache* cache = nullptr);
+
+    void BuildSteeredPatterns(const std::vector<int> &steps);
 
 
     void DivideAndFAST(std::vector<std::vector<knuff::KeyPoint> >& allKeypoints,
                        Distribution::DistributionMethod mode = Distribution::QUADTREE_ORBSLAMSTYLE,
                        bool divideImage = true, int cellSize = 30, bool distributePerLevel = true);
 
-    void ComputeScalePyramid(cv::Mat &image);
+    struct FASTGrid
+    {
+        int minimumX, minimumY, maximumX, maximumY;
+        int npatchesInX, npatchesInY;
+        int patchWidth, patchHeight;
+    };
+
+    FASTGrid ComputeFASTGrid(int lvl, int cellSize);
+
+    void FASTCellRows(int lvl, const FASTGrid &grid, int firstRow, int lastRow,
+                      std::vector<knuff::KeyPoint> &levelKpts);
+
+    void BuildPyramid(cv::Mat &image);
+
+    void DetectAndDistribute(std::vector<std::vector<knuff::KeyPoint>> &allkpts, bool distributePerLevel,
+                             bool computeAngles);
+
+    void ToImageCoordinates(const std::vector<std::vector<knuff::KeyPoint>> &allkpts,
+                            std::vector<knuff::KeyPoint> &resultKeypoints);
+
+    void ComputeScalePyramid(cv::Mat &image, int lastLevel = -1);
+
+    void AllocateScalePyramid(cv::Mat &image);
+
+    void WriteLevel0Rows(const cv::Mat &image, int firstRow, int lastRow);
+
+    void ComputeUpperLevels(int lastLevel = -1);
+
+    void ComputeLevel0Striped(const cv::Mat &image, int cellSize);
+
+    void ComputeBlurredPyramid();
+
+    bool BlurLevelSparse(int lvl, int expectedKpts);
+
+    void PrepareBlurredLevel(int lvl);
+
+    void BlurSparseLevels(std::vector<std::vector<knuff::KeyPoint>> &allkpts);
+
+    /** integral image of a level and its border for BRIEF::BOX smoothing */
+    void ComputeBoxSums(int lvl);
+
+    static void MakeBorderReflect101(cv::Mat &level, int border);
+
+    static void ReflectBorderColumns(cv::Mat &level, int border, int firstRow, int lastRow);
+
+    static void ReflectBorderRows(cv::Mat &level, int border, bool top, bool bottom);
+
+    void ResizeFromOctaveAnchor(int lvl, int &builtOctaves);
+
+    void UndistortLevel0(const cv::Mat &image, ImageIngest::InputFormat format, int firstRow, int lastRow);
 
     std::vector<cv::Point> pattern;
+    BRIEF::Pattern briefPattern;
+    std::vector<int> steeredPatterns;
 
     std::vector<cv::Mat> imagePyramid;
+    std::vector<cv::Mat> borderedPyramid;
+    std::vector<knuff::KeyPoint> level0Kpts;
+    std::vector<cv::Mat> octaveAnchors;
+    std::vector<cv::Mat> blurredPyramid;
+    std::vector<cv::Mat> borderedBlurredPyramid;
+    std::vector<std::vector<ushort>> blurRowBuffers;
+    std::vector<std::vector<uchar>> blurTileMasks;
+    std::vector<uchar> sparseBlurLevels;
+    std::vector<cv::Mat> boxSums;
+    std::vector<cv::Mat> borderedBoxSums;
+
+    BufferAllocator bufferAllocator;
+    std::vector<BufferAllocator::Block> pyramidBlocks;
+    std::vector<BufferAllocator::Block> blurredBlocks;
+    std::vector<BufferAllocator::Block> boxSumBlocks;
+    std::vector<BufferAllocator::Block> octaveAnchorBlocks;
+    BufferAllocator::Block ingestBlock;
+    std::vector<cv::Mat> momentSums;
+    std::vector<BufferAllocator::Block> momentSumBlocks;
 
     int nfeatures;
     double scaleFactor;
     int nlevels;
     int iniThFAST;
     int minThFAST;
+    int descriptorBits;
     bool stepsChanged;
+    bool wrapPaddedInput;
+    bool bayerGreenHalfResolution;
+    bool halfResolutionLevel0;
+    bool undistortInput;
+    bool octaveAnchoredPyramid;
+    bool stripedLevel0;
+    int stripeRows;
+    bool level0Wrapped;
+    bool level0Detected;
+    bool level0Blurred;
+    // incremented for every processed image, invalidates LazyFrames of the previous one
+    unsigned long frameId;
 
     int levelToDisplay;
 
@@ -158,7 +488,30 @@ protected:
 
     Distribution::DistributionMethod kptDistribution;
 
+    PyramidBlur::Mode blurMode;
+    BRIEF::Smoothing descriptorSmoothing;
+    bool prefetchFootprints;
+
+    Orientation::Method orientationMethod;
+    float orientationTolerance;
+    Orientation::Bins orientationBins;
+
+    bool useDescriptorCache;
+    DescriptorCache descriptorCache;
+
+    ImageIngest::InputFormat inputFormat;
+    ImageIngest::InputFormat level0Format;
+
+    cv::Mat cameraMatrix;
+    cv::Mat distortionCoeffs;
+    cv::Mat rectificationRotation;
+    cv::Mat newCameraMatrix;
+    ImageIngest::RemapLUT undistortLUT;
+    bool undistortLUTHalfResolution;
+    cv::Mat ingestBuffer;
+
     std::vector<int> pixelOffset;
+    std::vector<int> levelSteps;
 
     std::vector<int> nfeaturesPerLevelVec;
 
@@ -0,0 +1,114 @@
+#ifndef ORBEXTRACTOR_ORIENTATION_H
+#define ORBEXTRACTOR_ORIENTATION_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "include/Types.h"
+
+
+class Orientation
+{
+public:
+
+    enum Method
+    {
+        SCALAR = 0,
+        SIMD = 1,
+        PREFIX_SUM = 2
+    };
+
+    /**
+     * Orientation quantised to n bins of 360/n degrees, bin b centered at b*360/n. Bins are found from the
+     * moments with at most n/4+1 cross products against precomputed bin edges per quadrant, without atan2.
+     */
+    class Bins
+    {
+    public:
+        explicit Bins(int n = 0);
+
+        int inline Count() const
+        {
+            return n;
+        }
+
+        float inline Angle(int bin) const
+        {
+            return (float)bin * 360.f / (float)n;
+        }
+
+        /** bin whose center is closest to the direction of (m10, m01), directions on an edge go to the upper bin */
+        int Bin(float m10, float m01) const;
+
+    private:
+        int n;
+        // number of edges below the quadrant and the edges inside it as (cos, sin) relative to its start
+        int edgesBelow[4];
+        std::vector<cv::Point2f> edges[4];
+    };
+
+    /**
+     * Intensity centroid moments over the circular patch of diameter PATCH_SIZE around center, exactly the sums
+     * of ORBextractor::IntensityCentroidAngle. The AVX2 path reads 32 pixels per patch row starting 15 pixels
+     * left of center, i.e. one pixel more than the patch on the right.
+     */
+    static void Moments(const uchar* center, int step, int &m10, int &m01);
+
+    /**
+     * Sets the angle in degrees of every keypoint (level coordinates) from its intensity centroid. Moments
+     * are computed per keypoint, atan2 runs on batches of 8 with the cheapest polynomial of
+     * PolynomialDegree(tolerance). A tolerance of 0 uses cv::fastAtan2 itself.
+     * @param bins if given, angles are the centers of the bins chosen by Bins::Bin instead
+     */
+    static void ComputeAngles(const cv::Mat &level, std::vector<knuff::KeyPoint> &kpts, float tolerance,
+                              const Bins* bins = nullptr);
+
+    /**
+     * Size of the prefix sum image of a level: the level plus a frame of PATCH_SIZE/2 rows and PATCH_SIZE/2+1
+     * columns, with a leading zero column.
+     */
+    static cv::Size PrefixSumSize(cv::Size levelSize);
+
+    /**
+     * Interleaved row prefix sums of I and x*I (x counted from the left of the framed region) over a level with
+     * at least PATCH_SIZE/2+1 pixels of valid border, so both lookups of a row end share a cache line. Sums are
+     * accumulated modulo 2^32, the differences taken over one patch row are exact.
+     * @param sums CV_32SC2 of PrefixSumSize(level.size())
+     */
+    static void BuildPrefixSums(const cv::Mat &level, cv::Mat &sums);
+
+    /**
+     * As ComputeAngles, but the moments of every keypoint come from the differences of the prefix sums at
+     * both ends of each patch row.
+     */
+    static void ComputeAnglesFromPrefixSums(const cv::Mat &sums, std::vector<knuff::KeyPoint> &kpts,
+                                            float tolerance, const Bins* bins = nullptr);
+
+    /**
+     * Prefix sums cost about PREFIX_SUM_PIXEL_COST per framed pixel plus PREFIX_SUM_KPT_COST per keypoint,
+     * direct moments KPT_COST[method] per keypoint (nanoseconds, measured on 640x480 and 1920x1080 levels with
+     * 1 keypoint per 400 to 12 pixels). Prefix sums are preferred once that amortises, for SCALAR above roughly
+     * 1 keypoint per 120 pixels. SIMD moments are cheaper than the lookups, so SIMD never switches.
+     * Levels without keypoints never build prefix sums, not even with PREFIX_SUM.
+     */
+    static bool PreferPrefixSums(cv::Size levelSize, size_t nkpts, Method method);
+
+    /**
+     * atan2(y, x) in degrees [0, 360) with an odd polynomial of the given degree (3, 5 or 7) on the octant
+     * reduced argument. Degree 7 uses the coefficients of cv::fastAtan2.
+     */
+    static void Atan2(const float* y, const float* x, float* angles, int n, int degree);
+
+    /**
+     * Lowest polynomial degree whose largest deviation from cv::fastAtan2 is below tolerance degrees:
+     * 3 (0.29 degrees), 5 (0.04 degrees) or 7 (float rounding only).
+     */
+    static int PolynomialDegree(float tolerance);
+
+protected:
+
+    /** angles from the batch of moments, see ComputeAngles for tolerance and bins */
+    static void AnglesFromMoments(const float* m01, const float* m10, float* angles, int n, float tolerance,
+                                  const Bins* bins);
+};
+
+#endif //ORBEXTRACTOR_ORIENTATION_H
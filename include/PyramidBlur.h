@@ -0,0 +1,60 @@
+#ifndef ORBEXTRACTOR_PYRAMIDBLUR_H
+#define ORBEXTRACTOR_PYRAMIDBLUR_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "include/Types.h"
+
+
+class PyramidBlur
+{
+public:
+
+    enum Mode
+    {
+        AUTO = 0,
+        FULL = 1,
+        SPARSE = 2
+    };
+
+    /** every rotated BRIEF test of a keypoint lies within this distance (max |pattern point| is 18.4) */
+    static const int FOOTPRINT_RADIUS = 18;
+
+    /** sparse blurring marks and processes the level in tiles of this size */
+    static const int TILE_SIZE = 16;
+
+    /**
+     * 7x7 Gaussian with sigma 2, separable with 8 bit fixed point taps {18, 34, 49, 54, 49, 34, 18}. Rounding
+     * matches the bit exact 8-bit path of cv::GaussianBlur, so for a src with reflected border the result
+     * equals cv::GaussianBlur(..., cv::Size(7, 7), 2, 2, cv::BORDER_REFLECT_101).
+     * @param src ROI with at least 3 pixels of valid border on every side, e.g. an interior pyramid level
+     * @param dst same size as src, may be a ROI, must not alias src
+     * @param rowBuffer scratch memory for the horizontal pass, kept by the caller to avoid reallocation
+     */
+    static void Gaussian7x7(const cv::Mat &src, cv::Mat &dst, std::vector<ushort> &rowBuffer);
+
+    /**
+     * Blurs only the (2*FOOTPRINT_RADIUS+1)^2 footprints around kpts, clipped to the level. Overlapping
+     * footprints are deduplicated by marking tiles, horizontal runs of marked tiles are blurred in one pass.
+     * Inside the footprints the result equals Gaussian7x7, the rest of dst is left untouched.
+     * @param kpts keypoints in level coordinates
+     * @param tileMask scratch memory kept by the caller
+     */
+    static void Gaussian7x7Sparse(const cv::Mat &src, cv::Mat &dst, const std::vector<knuff::KeyPoint> &kpts,
+                                  std::vector<uchar> &tileMask, std::vector<ushort> &rowBuffer);
+
+    /**
+     * Cost model: a footprint touches up to ((2*FOOTPRINT_RADIUS + TILE_SIZE) / TILE_SIZE)^2 tiles and every
+     * tile row recomputes 6 rows of the horizontal pass. Sparse blurring is preferred if that estimate for
+     * expectedKpts (ignoring overlaps) stays below half of the level area, as it cannot be overlapped with FAST.
+     */
+    static bool PreferSparse(cv::Size levelSize, int expectedKpts);
+
+protected:
+
+    static void HorizontalPass(const uchar* src, ushort* dst, int width);
+
+    static void VerticalPass(const ushort* const rows[7], uchar* dst, int width);
+};
+
+#endif //ORBEXTRACTOR_PYRAMIDBLUR_H
@@ -0,0 +1,65 @@
+#ifndef ORBEXTRACTOR_STEREOEXTRACTOR_H
+#define ORBEXTRACTOR_STEREOEXTRACTOR_H
+
+#include <vector>
+#include "include/ORBextractor.h"
+
+
+/**
+ * Extracts a rectified stereo pair with two ORBextractors at the same time and matches left to right keypoints
+ * along epipolar rows, like ORB-SLAM2's stereo frame: every right keypoint is registered in the rows within
+ * 2*scale of its octave, and a left keypoint is compared with the right keypoints of its row whose disparity lies
+ * in [minDisparity, maxDisparity] and whose octave differs by at most 1.
+ */
+class StereoExtractor
+{
+public:
+
+    struct StereoMatch
+    {
+        int left;
+        int right;
+        int distance;
+        /** x of the left minus x of the right keypoint */
+        float disparity;
+    };
+
+    /** both extractors have to use the same number of levels and scale factor */
+    StereoExtractor(ORB_SLAM2::ORBextractor &left, ORB_SLAM2::ORBextractor &right);
+
+    /**
+     * Runs both extractions concurrently as two OpenMP tasks, each with half of the caller's OpenMP threads in
+     * nested teams, and then matches the keypoints. The caller's OpenMP settings are not changed, exceptions of
+     * either side are rethrown once both are done. Descriptors are those of ORBextractor::operator().
+     * @param matches best right keypoint of every matched left keypoint, ordered by left index
+     */
+    void operator()(cv::InputArray leftImage, cv::InputArray rightImage,
+                    std::vector<knuff::KeyPoint> &leftKeypoints, cv::OutputArray leftDescriptors,
+                    std::vector<knuff::KeyPoint> &rightKeypoints, cv::OutputArray rightDescriptors,
+                    std::vector<StereoMatch> &matches, bool distributePerLevel = true);
+
+    void Match(const std::vector<knuff::KeyPoint> &leftKeypoints, const cv::Mat &leftDescriptors,
+               const std::vector<knuff::KeyPoint> &rightKeypoints, const cv::Mat &rightDescriptors, int rows,
+               std::vector<StereoMatch> &matches) const;
+
+    void inline SetDisparityRange(float min, float max)
+    {
+        minDisparity = min;
+        maxDisparity = max;
+    }
+
+    /** largest Hamming distance of a match, ORB-SLAM2 uses 75 */
+    void inline SetMaxDistance(int d)
+    {
+        maxDistance = d;
+    }
+
+private:
+    ORB_SLAM2::ORBextractor &left;
+    ORB_SLAM2::ORBextractor &right;
+    float minDisparity;
+    float maxDisparity;
+    int maxDistance;
+};
+
+#endif //ORBEXTRACTOR_STEREOEXTRACTOR_H
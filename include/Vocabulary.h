@@ -0,0 +1,140 @@
+#ifndef ORBEXTRACTOR_VOCABULARY_H
+#define ORBEXTRACTOR_VOCABULARY_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "include/DescriptorStore.h"
+#include "include/MappedFile.h"
+
+
+/**
+ * Hierarchical k-means vocabulary tree over 256 bit descriptors, compatible with the DBoW2 vocabularies used by
+ * ORB-SLAM2 (e.g. ORBvoc.txt). Nodes are laid out breadth first, so the children of every node are contiguous
+ * rows of 32 byte aligned descriptors and can be compared to a query 4 at a time. Word ids and weights are kept
+ * from the text file, so bag-of-words vectors are interchangeable with DBoW2's.
+ *
+ * The text format is only parsed once: Save writes the flat arrays to a binary file that Load maps read-only into
+ * memory.
+ */
+class Vocabulary
+{
+public:
+
+    enum Scoring
+    {
+        L1_NORM = 0,
+        L2_NORM,
+        CHI_SQUARE,
+        KL,
+        BHATTACHARYYA,
+        DOT_PRODUCT
+    };
+
+    enum Weighting
+    {
+        TF_IDF = 0,
+        TF,
+        IDF,
+        BINARY
+    };
+
+    /** (word id, weight) pairs ordered by word id */
+    typedef std::vector<std::pair<uint32_t, float>> BowVector;
+
+    Vocabulary();
+
+    ~Vocabulary();
+
+    Vocabulary(const Vocabulary &other) = delete;
+
+    Vocabulary& operator=(const Vocabulary &other) = delete;
+
+    /** parses a DBoW2 text vocabulary, false if the file is missing or malformed */
+    bool LoadText(const std::string &filename);
+
+    bool Save(const std::string &filename) const;
+
+    /** maps a vocabulary written by Save read-only into memory, false if the file is missing or invalid */
+    bool Load(const std::string &filename);
+
+    bool inline Empty() const
+    {
+        return nwords == 0;
+    }
+
+    uint32_t inline Size() const
+    {
+        return nwords;
+    }
+
+    uint32_t inline GetNodeCount() const
+    {
+        return nnodes;
+    }
+
+    inline Scoring GetScoring() const
+    {
+        return scoring;
+    }
+
+    inline Weighting GetWeighting() const
+    {
+        return weighting;
+    }
+
+    inline float GetWordWeight(uint32_t word) const
+    {
+        return weights[word];
+    }
+
+    /** word of a single descriptor */
+    uint32_t Word(const uint64_t* descriptor) const;
+
+    /**
+     * Converts the descriptors of a frame to a bag-of-words vector, weighted and normalised like DBoW2 does for
+     * the scoring and weighting of the vocabulary. Words are looked up in parallel.
+     * @param wordIds if not null, receives the word of every descriptor row
+     */
+    void Transform(const DescriptorStore &descriptors, BowVector &bow, std::vector<uint32_t>* wordIds = nullptr) const;
+
+    /** @param descriptors CV_8U with 32 columns, e.g. the output of ORBextractor */
+    void Transform(const cv::Mat &descriptors, BowVector &bow, std::vector<uint32_t>* wordIds = nullptr) const;
+
+    /** L1 similarity of two L1 normalised vectors in [0, 1], DBoW2's default score */
+    static double Score(const BowVector &a, const BowVector &b);
+
+protected:
+
+    struct Node
+    {
+        uint32_t firstChild;
+        uint32_t childCount;
+        int32_t word;   // -1 for inner nodes
+        uint32_t reserved;
+    };
+
+    void Release();
+
+    uint32_t nnodes;
+    uint32_t nwords;
+    uint32_t branching;
+    uint32_t depth;
+    Scoring scoring;
+    Weighting weighting;
+
+    // views onto either the owned arrays or the mapped file, node 0 is the root
+    const Node* nodes;
+    const uint64_t* descriptors;
+    const float* weights;
+
+    std::vector<Node> ownedNodes;
+    DescriptorStore ownedDescriptors;
+    std::vector<float> ownedWeights;
+
+    MappedFile mapped;
+};
+
+#endif //ORBEXTRACTOR_VOCABULARY_H
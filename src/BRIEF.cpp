@@ -0,0 +1,269 @@
+#include "include/BRIEF.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+
+BRIEF::Pattern::Pattern(const cv::Point* points, int _tests) : tests(_tests)
+{
+    assert(tests > 0 && tests <= MAX_TESTS && tests % 8 == 0);
+    for (int i = 0; i < tests; ++i)
+    {
+        x0[i] = (float)points[2*i].x;
+        y0[i] = (float)points[2*i].y;
+        x1[i] = (float)points[2*i + 1].x;
+        y1[i] = (float)points[2*i + 1].y;
+    }
+}
+
+
+void BRIEF::Steer(const Pattern &pattern, float angle, int step, int* off0, int* off1)
+{
+    const float angleRad = angle * (float)(CV_PI/180.f);
+    const auto a = (float)cos(angleRad), b = (float)sin(angleRad);
+
+    int i = 0;
+#ifdef __AVX2__
+    // explicitly fused like the contracted scalar expressions below
+    const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+    const __m256i vstep = _mm256_set1_epi32(step);
+    for (; i < pattern.tests; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(pattern.x0 + i), y = _mm256_loadu_ps(pattern.y0 + i);
+        __m256i u = _mm256_cvtps_epi32(_mm256_fmsub_ps(x, va, _mm256_mul_ps(y, vb)));
+        __m256i v = _mm256_cvtps_epi32(_mm256_fmadd_ps(x, vb, _mm256_mul_ps(y, va)));
+        _mm256_storeu_si256((__m256i*)(off0 + i), _mm256_add_epi32(u, _mm256_mullo_epi32(v, vstep)));
+
+        x = _mm256_loadu_ps(pattern.x1 + i);
+        y = _mm256_loadu_ps(pattern.y1 + i);
+        u = _mm256_cvtps_epi32(_mm256_fmsub_ps(x, va, _mm256_mul_ps(y, vb)));
+        v = _mm256_cvtps_epi32(_mm256_fmadd_ps(x, vb, _mm256_mul_ps(y, va)));
+        _mm256_storeu_si256((__m256i*)(off1 + i), _mm256_add_epi32(u, _mm256_mullo_epi32(v, vstep)));
+    }
+#endif
+    for (; i < pattern.tests; ++i)
+    {
+        off0[i] = (int)lrintf(pattern.x0[i]*a - pattern.y0[i]*b) +
+                  (int)lrintf(pattern.x0[i]*b + pattern.y0[i]*a)*step;
+        off1[i] = (int)lrintf(pattern.x1[i]*a - pattern.y1[i]*b) +
+                  (int)lrintf(pattern.x1[i]*b + pattern.y1[i]*a)*step;
+    }
+}
+
+
+template <int BITS>
+void BRIEF::Describe(const uchar* center, const int* off0, const int* off1, uchar* descriptor)
+{
+    static_assert(BITS % 32 == 0 && BITS <= MAX_TESTS, "Descriptor length must be a multiple of 32 bits");
+#if defined(__AVX512F__)
+    const auto base = (const int*)center;
+    const __m512i lowByte = _mm512_set1_epi32(0xFF);
+    alignas(32) uint16_t words[BITS/16];
+    for (int i = 0; i < BITS; i += 16)
+    {
+        __m512i v0 = _mm512_and_si512(_mm512_i32gather_epi32(_mm512_loadu_si512(off0 + i), base, 1), lowByte);
+        __m512i v1 = _mm512_and_si512(_mm512_i32gather_epi32(_mm512_loadu_si512(off1 + i), base, 1), lowByte);
+        words[i/16] = (uint16_t)_mm512_cmplt_epi32_mask(v0, v1);
+    }
+#elif defined(__AVX2__)
+    const auto base = (const int*)center;
+    const __m256i lowByte = _mm256_set1_epi32(0xFF);
+    alignas(32) uint32_t words[BITS/32];
+    for (int i = 0; i < BITS; i += 32)
+    {
+        uint32_t word = 0;
+        for (int j = 0; j < 32; j += 8)
+        {
+            __m256i v0 = _mm256_and_si256(
+                    _mm256_i32gather_epi32(base, _mm256_loadu_si256((const __m256i*)(off0 + i + j)), 1), lowByte);
+            __m256i v1 = _mm256_and_si256(
+                    _mm256_i32gather_epi32(base, _mm256_loadu_si256((const __m256i*)(off1 + i + j)), 1), lowByte);
+            auto bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v1, v0)));
+            word |= bits << j;
+        }
+        words[i/32] = word;
+    }
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+    memcpy(descriptor, words, BITS/8);
+#else
+    DescribeScalar<BITS>(center, off0, off1, descriptor);
+#endif
+}
+
+
+template <int BITS>
+void BRIEF::DescribeScalar(const uchar* center, const int* off0, const int* off1, uchar* descriptor)
+{
+    for (int byte = 0; byte < BITS/8; ++byte)
+    {
+        int val = 0;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            const int i = byte*8 + bit;
+            val |= (center[off0[i]] < center[off1[i]]) << bit;
+        }
+        descriptor[byte] = (uchar)val;
+    }
+}
+
+
+void BRIEF::PrefetchFootprint(const uchar* center, size_t rowBytes, int elemBytes, int radius)
+{
+    const int halfWidth = radius * elemBytes;
+    for (int r = -radius; r <= radius; ++r)
+    {
+        const uchar* row = center + (ptrdiff_t)r * (ptrdiff_t)rowBytes;
+        const auto first = (uintptr_t)(row - halfWidth) & ~(uintptr_t)63;
+        for (uintptr_t line = first; line <= (uintptr_t)(row + halfWidth + elemBytes - 1); line += 64)
+            __builtin_prefetch((const void*)line);
+    }
+}
+
+
+void BRIEF::BoxSums(const cv::Mat &level, int border, cv::Mat &sums)
+{
+    assert(sums.type() == CV_32S && sums.rows == level.rows + 2*border && sums.cols == (int)level.step1());
+    const int width = level.cols + 2*border;
+    const auto levelStep = (int)level.step;
+
+    for (int y = 0; y < sums.rows; ++y)
+    {
+        const uchar* src = level.ptr<uchar>(0) + (y - border)*levelStep - border;
+        auto dst = sums.ptr<uint32_t>(y);
+        const uint32_t* prev = y > 0 ? sums.ptr<uint32_t>(y - 1) : nullptr;
+
+        int x = 0;
+        uint32_t rowSum = 0;
+#ifdef __AVX2__
+        // prefix sums of 8 pixels: within 128 bit lanes by shifting, then the low lane total is carried up
+        __m256i carry = _mm256_setzero_si256();
+        const __m256i lowLaneLast = _mm256_setr_epi32(0, 0, 0, 0, 3, 3, 3, 3);
+        const __m256i last = _mm256_set1_epi32(7);
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + x)));
+            v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+            v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+            v = _mm256_add_epi32(v, _mm256_blend_epi32(_mm256_setzero_si256(),
+                                                       _mm256_permutevar8x32_epi32(v, lowLaneLast), 0xF0));
+            v = _mm256_add_epi32(v, carry);
+            carry = _mm256_permutevar8x32_epi32(v, last);
+
+            __m256i above = prev ? _mm256_loadu_si256((const __m256i*)(prev + x)) : _mm256_setzero_si256();
+            _mm256_storeu_si256((__m256i*)(dst + x), _mm256_add_epi32(v, above));
+        }
+        rowSum = (uint32_t)_mm256_cvtsi256_si32(carry);
+#endif
+        for (; x < width; ++x)
+        {
+            rowSum += src[x];
+            dst[x] = rowSum + (prev ? prev[x] : 0u);
+        }
+    }
+}
+
+
+template <int BITS>
+void BRIEF::DescribeBox(const uint32_t* center, int step, const int* off0, const int* off1, uchar* descriptor)
+{
+    static_assert(BITS % 32 == 0 && BITS <= MAX_TESTS, "Descriptor length must be a multiple of 32 bits");
+#if defined(__AVX512F__) || defined(__AVX2__)
+    // box sum = I(hi, hi) - I(lo, hi) - I(hi, lo) + I(lo, lo) with hi = BOX_RADIUS, lo = -BOX_RADIUS - 1
+    const int hi = BOX_RADIUS, lo = -BOX_RADIUS - 1;
+    const int cornerHH = hi + hi*step, cornerLH = hi + lo*step, cornerHL = lo + hi*step, cornerLL = lo + lo*step;
+#endif
+
+#if defined(__AVX512F__)
+    const auto base = (const int*)center;
+    const __m512i hh = _mm512_set1_epi32(cornerHH), lh = _mm512_set1_epi32(cornerLH);
+    const __m512i hl = _mm512_set1_epi32(cornerHL), ll = _mm512_set1_epi32(cornerLL);
+    auto boxSums = [&](__m512i offsets)
+    {
+        __m512i s = _mm512_sub_epi32(_mm512_i32gather_epi32(_mm512_add_epi32(offsets, hh), base, 4),
+                                     _mm512_i32gather_epi32(_mm512_add_epi32(offsets, lh), base, 4));
+        s = _mm512_sub_epi32(s, _mm512_i32gather_epi32(_mm512_add_epi32(offsets, hl), base, 4));
+        return _mm512_add_epi32(s, _mm512_i32gather_epi32(_mm512_add_epi32(offsets, ll), base, 4));
+    };
+    alignas(32) uint16_t words[BITS/16];
+    for (int i = 0; i < BITS; i += 16)
+    {
+        __m512i v0 = boxSums(_mm512_loadu_si512(off0 + i));
+        __m512i v1 = boxSums(_mm512_loadu_si512(off1 + i));
+        words[i/16] = (uint16_t)_mm512_cmplt_epi32_mask(v0, v1);
+    }
+#elif defined(__AVX2__)
+    const auto base = (const int*)center;
+    const __m256i hh = _mm256_set1_epi32(cornerHH), lh = _mm256_set1_epi32(cornerLH);
+    const __m256i hl = _mm256_set1_epi32(cornerHL), ll = _mm256_set1_epi32(cornerLL);
+    auto boxSums = [&](__m256i offsets)
+    {
+        __m256i s = _mm256_sub_epi32(_mm256_i32gather_epi32(base, _mm256_add_epi32(offsets, hh), 4),
+                                     _mm256_i32gather_epi32(base, _mm256_add_epi32(offsets, lh), 4));
+        s = _mm256_sub_epi32(s, _mm256_i32gather_epi32(base, _mm256_add_epi32(offsets, hl), 4));
+        return _mm256_add_epi32(s, _mm256_i32gather_epi32(base, _mm256_add_epi32(offsets, ll), 4));
+    };
+    alignas(32) uint32_t words[BITS/32];
+    for (int i = 0; i < BITS; i += 32)
+    {
+        uint32_t word = 0;
+        for (int j = 0; j < 32; j += 8)
+        {
+            __m256i v0 = boxSums(_mm256_loadu_si256((const __m256i*)(off0 + i + j)));
+            __m256i v1 = boxSums(_mm256_loadu_si256((const __m256i*)(off1 + i + j)));
+            auto bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v1, v0)));
+            word |= bits << j;
+        }
+        words[i/32] = word;
+    }
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+    memcpy(descriptor, words, BITS/8);
+#else
+    DescribeBoxScalar<BITS>(center, step, off0, off1, descriptor);
+#endif
+}
+
+
+template <int BITS>
+void BRIEF::DescribeBoxScalar(const uint32_t* center, int step, const int* off0, const int* off1, uchar* descriptor)
+{
+    const int hi = BOX_RADIUS, lo = -BOX_RADIUS - 1;
+    auto boxSum = [&](int offset)
+    {
+        const uint32_t* p = center + offset;
+        return (int)(p[hi + hi*step] - p[hi + lo*step] - p[lo + hi*step] + p[lo + lo*step]);
+    };
+
+    for (int byte = 0; byte < BITS/8; ++byte)
+    {
+        int val = 0;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            const int i = byte*8 + bit;
+            val |= (boxSum(off0[i]) < boxSum(off1[i])) << bit;
+        }
+        descriptor[byte] = (uchar)val;
+    }
+}
+
+
+template void BRIEF::Describe<128>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::Describe<256>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::Describe<512>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::DescribeScalar<128>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::DescribeScalar<256>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::DescribeScalar<512>(const uchar*, const int*, const int*, uchar*);
+template void BRIEF::DescribeBox<128>(const uint32_t*, int, const int*, const int*, uchar*);
+template void BRIEF::DescribeBox<256>(const uint32_t*, int, const int*, const int*, uchar*);
+template void BRIEF::DescribeBox<512>(const uint32_t*, int, const int*, const int*, uchar*);
+template void BRIEF::DescribeBoxScalar<128>(const uint32_t*, int, const int*, const int*, uchar*);
+template void BRIEF::DescribeBoxScalar<256>(const uint32_t*, int, const int*, const int*, uchar*);
+template void BRIEF::DescribeBoxScalar<512>(const uint32_t*, int, const int*, const int*, uchar*);
@@ -0,0 +1,130 @@
+#include "include/BufferAllocator.h"
+#include <cstdlib>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const size_t HUGE_PAGE_SIZE = (size_t)2 << 20;
+const size_t SMALL_PAGE_SIZE = 4096;
+
+
+BufferAllocator::Block::Block(Block &&other) noexcept :
+        data(other.data), size(other.size), mapBase(other.mapBase), mapSize(other.mapSize), mode(other.mode),
+        granted(other.granted)
+{
+    other.data = nullptr;
+    other.size = 0;
+    other.mapBase = nullptr;
+    other.mapSize = 0;
+}
+
+
+BufferAllocator::Block& BufferAllocator::Block::operator=(Block &&other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(mapBase, other.mapBase);
+        std::swap(mapSize, other.mapSize);
+        mode = other.mode;
+        granted = other.granted;
+    }
+    return *this;
+}
+
+
+void BufferAllocator::Block::Release()
+{
+#ifdef __linux__
+    if (mapBase)
+        munmap(mapBase, mapSize);
+    else
+#endif
+        free(data);
+
+    data = nullptr;
+    size = 0;
+    mapBase = nullptr;
+    mapSize = 0;
+}
+
+
+bool BufferAllocator::Create(cv::Mat &mat, int rows, int cols, int type, Block &block) const
+{
+    const size_t bytes = (size_t)rows * cols * CV_ELEM_SIZE(type);
+    bool reallocated = false;
+
+    if (!block.data || block.size < bytes || block.mode != pageMode)
+    {
+        block.Release();
+        Allocate(block, bytes, pageMode);
+        reallocated = true;
+
+        if (firstTouch)
+        {
+            const size_t stride = block.granted == REGULAR_PAGES ? SMALL_PAGE_SIZE : HUGE_PAGE_SIZE;
+            for (size_t i = 0; i < bytes; i += stride)
+                block.data[i] = 0;
+        }
+    }
+
+    mat = cv::Mat(rows, cols, type, block.data);
+    return reallocated;
+}
+
+
+void BufferAllocator::Allocate(Block &block, size_t bytes, PageMode mode)
+{
+    block.mode = mode;
+    block.granted = REGULAR_PAGES;
+    bytes = std::max(bytes, (size_t)1);
+
+#ifdef __linux__
+    if (mode != REGULAR_PAGES)
+    {
+        const size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+        if (mode == EXPLICIT_HUGE_PAGES)
+        {
+            void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                           -1, 0);
+            if (p != MAP_FAILED)
+            {
+                block.mapBase = p;
+                block.mapSize = rounded;
+                block.data = (uchar*)p;
+                block.size = rounded;
+                block.granted = EXPLICIT_HUGE_PAGES;
+                return;
+            }
+        }
+#endif
+        // transparent huge pages only back 2MB aligned ranges, so one extra huge page is mapped for alignment
+        void* p = mmap(nullptr, rounded + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            auto aligned = (uchar*)(((size_t)p + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+#ifdef MADV_HUGEPAGE
+            if (madvise(aligned, rounded, MADV_HUGEPAGE) == 0)
+                block.granted = TRANSPARENT_HUGE_PAGES;
+#endif
+            block.mapBase = p;
+            block.mapSize = rounded + HUGE_PAGE_SIZE;
+            block.data = aligned;
+            block.size = rounded;
+            return;
+        }
+    }
+#endif
+
+    void* p = nullptr;
+    if (posix_memalign(&p, 64, bytes) != 0)
+        throw std::bad_alloc();
+    block.data = (uchar*)p;
+    block.size = bytes;
+}
@@ -0,0 +1,51 @@
+#include "include/Decimator.h"
+#include <cassert>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+void Decimator::Box2x(const cv::Mat &src, cv::Mat &dst)
+{
+    assert(src.type() == CV_8UC1 && dst.type() == CV_8UC1);
+    assert(dst.cols == src.cols/2 && dst.rows == src.rows/2);
+
+#pragma omp parallel for
+    for (int y = 0; y < dst.rows; ++y)
+    {
+        Box2xRow(src.ptr<uchar>(2*y), src.ptr<uchar>(2*y + 1), dst.ptr<uchar>(y), dst.cols);
+    }
+}
+
+
+void Decimator::Box2xRow(const uchar* row0, const uchar* row1, uchar* dst, const int width)
+{
+    int x = 0;
+
+#ifdef __AVX2__
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi16(2);
+
+    for ( ; x < width - 31; x += 32)
+    {
+        // maddubs with ones adds horizontal pairs into 16 bit lanes
+        __m256i a = _mm256_add_epi16(
+                _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2*x)), ones),
+                _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2*x)), ones));
+        __m256i b = _mm256_add_epi16(
+                _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row0 + 2*x + 32)), ones),
+                _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(row1 + 2*x + 32)), ones));
+        a = _mm256_srli_epi16(_mm256_add_epi16(a, two), 2);
+        b = _mm256_srli_epi16(_mm256_add_epi16(b, two), 2);
+
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + x), packed);
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        dst[x] = (uchar)((row0[2*x] + row0[2*x + 1] + row1[2*x] + row1[2*x + 1] + 2) >> 2);
+    }
+}
@@ -0,0 +1,87 @@
+#include "include/DescriptorCache.h"
+#include <cmath>
+#include <cstring>
+
+
+DescriptorCache::DescriptorCache(float angleQuantum, int signatureTolerance) : stats{0, 0, 0.f, 0.}
+{
+    SetTolerances(angleQuantum, signatureTolerance);
+}
+
+
+void DescriptorCache::SetTolerances(float _angleQuantum, int signatureTolerance)
+{
+    angleBins = std::max((int)lrint(360.f / _angleQuantum), 1);
+    angleQuantum = 360.f / (float)angleBins;
+    tolerance = signatureTolerance;
+    Clear();
+}
+
+
+void DescriptorCache::Clear()
+{
+    entries.clear();
+    signatures.clear();
+    descriptors.release();
+}
+
+
+uint64_t DescriptorCache::Key(const knuff::KeyPoint &kpt) const
+{
+    const auto x = (uint64_t)lrint(kpt.pt.x), y = (uint64_t)lrint(kpt.pt.y);
+    const auto bin = (uint64_t)(lrint(kpt.angle / angleQuantum) % angleBins);
+    return (uint64_t)kpt.octave << 58 | bin << 48 | y << 24 | x;
+}
+
+
+void DescriptorCache::Signature(const uchar* center, int step, uchar* signature)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        const uchar* row = center + (8*i - 12)*step;
+        for (int j = 0; j < 4; ++j)
+            signature[4*i + j] = row[8*j - 12];
+    }
+}
+
+
+bool DescriptorCache::Lookup(uint64_t key, uchar* signature, uchar* descriptor) const
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return false;
+
+    const uchar* stored = &signatures[(size_t)it->second * SIGNATURE_SIZE];
+    for (int i = 0; i < SIGNATURE_SIZE; ++i)
+    {
+        if (std::abs(stored[i] - signature[i]) > tolerance)
+            return false;
+    }
+
+    memcpy(signature, stored, SIGNATURE_SIZE);
+    memcpy(descriptor, descriptors.ptr(it->second), descriptors.cols);
+    return true;
+}
+
+
+void DescriptorCache::Update(const std::vector<uint64_t> &keys, const std::vector<uchar> &_signatures,
+                             const cv::Mat &_descriptors, const std::vector<int>* rows, int hits,
+                             double describeMicroseconds)
+{
+    const int n = (int)keys.size();
+    const int misses = n - hits;
+    stats.keypoints = n;
+    stats.hits = hits;
+    stats.hitRatio = n > 0 ? (float)hits / (float)n : 0.f;
+    stats.savedMicroseconds = misses > 0 ? hits * describeMicroseconds / misses : 0.;
+
+    entries.clear();
+    entries.reserve((size_t)n);
+    signatures = _signatures;
+    descriptors.create(n, _descriptors.cols, CV_8U);
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(descriptors.ptr(i), _descriptors.ptr(rows ? (*rows)[i] : i), _descriptors.cols);
+        entries[keys[i]] = i;
+    }
+}
@@ -0,0 +1,27 @@
+#include "include/DescriptorStore.h"
+#include <cassert>
+#include <cstring>
+
+
+DescriptorStore::DescriptorStore(const cv::Mat &descriptors) : rows(0)
+{
+    Assign(descriptors);
+}
+
+
+void DescriptorStore::Assign(const cv::Mat &descriptors)
+{
+    rows = descriptors.empty() ? 0 : descriptors.rows;
+    if (rows == 0)
+    {
+        mat = cv::Mat();
+        return;
+    }
+    assert(descriptors.type() == CV_8U && descriptors.cols == ROW_BYTES);
+
+    allocator.Create(mat, rows, ROW_BYTES, CV_8U, block);
+    if (descriptors.isContinuous())
+        memcpy(mat.data, descriptors.data, (size_t)rows * ROW_BYTES);
+    else
+        descriptors.copyTo(mat);
+}
@@ -6,6 +6,9 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <cfloat>
+#include <cstdint>
+#include <cmath>
 
 //TODO:remove include of iostream and chrono after debugging
 #include <iostream>
@@ -22,6 +25,24 @@ static void RetainBestN(std::vector<knuff::KeyPoint> &kpts, int N)
 }
 
 
+/** sets bits first to last (inclusive) of a bitset of 64 bit words */
+static void SetBits(uint64_t* words, int first, int last)
+{
+    const int firstWord = first >> 6, lastWord = last >> 6;
+    const uint64_t firstMask = ~(uint64_t)0 << (first & 63);
+    const uint64_t lastMask = ~(uint64_t)0 >> (63 - (last & 63));
+    if (firstWord == lastWord)
+    {
+        words[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    words[firstWord] |= firstMask;
+    for (int w = firstWord + 1; w < lastWord; ++w)
+        words[w] = ~(uint64_t)0;
+    words[lastWord] |= lastMask;
+}
+
+
 void
 Distribution::DistributeKeypoints(std::vector<knuff::KeyPoint> &kpts, const int minX, const int maxX, const int minY,
                     const int maxY, const int N, DistributionMethod mode, float softSSCThreshold)
@@ -108,6 +129,11 @@ Distribution::DistributeKeypoints(std::vector<knuff::KeyPoint> &kpts, const int
             DistributeKeypointsVSSC(kpts, minX, maxX, minY, maxY, N, epsilon, softSSCThreshold);
             break;
         }
+        case ANMS_EXACT:
+        {
+            DistributeKeypointsExactANMS(kpts, N);
+            break;
+        }
         default:
         {
             int cols = maxX - minX;
@@ -951,6 +977,10 @@ void Distribution::DistributeKeypointsSSC(std::vector<knuff::KeyPoint> &kpts, in
     std::vector<int> tempResult;
     tempResult.reserve(kpts.size());
 
+    // coverage grid as one bit per cell, rows padded to whole words; kept per thread, as levels are distributed
+    // in parallel, so the binary search and later calls reuse the allocation
+    static thread_local std::vector<uint64_t> covered;
+
     while(!done)
     {
         width = low + (high-low)/2;
@@ -963,14 +993,15 @@ void Distribution::DistributeKeypointsSSC(std::vector<knuff::KeyPoint> &kpts, in
         double c = (double)width/2.0;
         int cellCols = std::floor(cols/c);
         int cellRows = std::floor(rows/c);
-        std::vector<std::vector<bool>> covered(cellRows+1, std::vector<bool>(cellCols+1, false));
+        const int rowWords = (cellCols + 64) / 64;
+        covered.assign((size_t)(cellRows+1) * rowWords, 0);
 
         for (int i = 0; i < kpts.size(); ++i)
         {
             int row = (int)(kpts[i].pt.y/c);
             int col = (int)(kpts[i].pt.x/c);
 
-            if (covered[row][col] == false)
+            if (!(covered[(size_t)row*rowWords + (col >> 6)] >> (col & 63) & 1))
             {
                 tempResult.emplace_back(i);
                 int rowMin = row - (int)(width/c) >= 0 ? (row - (int)(width/c)) : 0;
@@ -979,13 +1010,7 @@ void Distribution::DistributeKeypointsSSC(std::vector<knuff::KeyPoint> &kpts, in
                 int colMax = col + (int)(width/c) <= cellCols ? (col + (int)(width/c)) : cellCols;
 
                 for (int dy = rowMin; dy <= rowMax; ++dy)
-                {
-                    for (int dx = colMin; dx <= colMax; ++dx)
-                    {
-                        if (!covered[dy][dx])
-                            covered[dy][dx] = true;
-                    }
-                }
+                    SetBits(&covered[(size_t)dy*rowWords], colMin, colMax);
             }
         }
         if (tempResult.size() >= kMin && tempResult.size() <= kMax)
@@ -1371,3 +1396,110 @@ void Distribution::DistributeKeypointsVSSC(std::vector<knuff::KeyPoint> &kpts, c
     }
     kpts = reskpts;
 }
+
+
+void Distribution::DistributeKeypointsExactANMS(std::vector<knuff::KeyPoint> &kpts, int N)
+{
+    const int n = (int)kpts.size();
+
+    // response order, ties by index
+    std::vector<std::pair<float, int>> byResponse(n);
+    for (int i = 0; i < n; ++i)
+        byResponse[i] = std::make_pair(-kpts[i].response, i);
+    std::sort(byResponse.begin(), byResponse.end());
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i)
+        order[i] = byResponse[i].second;
+
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+    for (const knuff::KeyPoint &kpt : kpts)
+    {
+        minX = std::min(minX, kpt.pt.x);
+        maxX = std::max(maxX, kpt.pt.x);
+        minY = std::min(minY, kpt.pt.y);
+        maxY = std::max(maxY, kpt.pt.y);
+    }
+
+    // about four keypoints per cell, fewer empty cells to visit for the strongest keypoints
+    const float c = std::max(1.f, 2 * std::sqrt((maxX - minX + 1) * (maxY - minY + 1) / (float)n));
+    const int cellCols = (int)((maxX - minX) / c) + 1;
+    const int cellRows = (int)((maxY - minY) / c) + 1;
+
+    // keypoints bucketed by cell in response order (compressed rows), ranks below the current one are inserted
+    struct Entry
+    {
+        float x, y;
+        int rank;
+    };
+    std::vector<int> cellOf(n), cellStart(cellRows*cellCols + 1, 0);
+    std::vector<Entry> cellEntries(n);
+    for (int rank = 0; rank < n; ++rank)
+    {
+        const knuff::KeyPoint &kpt = kpts[order[rank]];
+        cellOf[rank] = (int)((kpt.pt.y - minY) / c) * cellCols + (int)((kpt.pt.x - minX) / c);
+        ++cellStart[cellOf[rank] + 1];
+    }
+    for (int i = 0; i < cellRows*cellCols; ++i)
+        cellStart[i + 1] += cellStart[i];
+    {
+        std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+        for (int rank = 0; rank < n; ++rank)
+        {
+            const knuff::KeyPoint &kpt = kpts[order[rank]];
+            cellEntries[cursor[cellOf[rank]]++] = Entry {kpt.pt.x, kpt.pt.y, rank};
+        }
+    }
+
+    // squared suppression radius by rank, the strongest keypoint is never suppressed
+    std::vector<float> radius(n, FLT_MAX);
+    for (int rank = 1; rank < n; ++rank)
+    {
+        const float x = kpts[order[rank]].pt.x, y = kpts[order[rank]].pt.y;
+        const int row = cellOf[rank] / cellCols, col = cellOf[rank] % cellCols;
+        // a keypoint in ring r is at least (r-1)*c + margin away
+        const float fx = x - minX - col*c, fy = y - minY - row*c;
+        const float margin = std::max(0.f, std::min(std::min(fx, c - fx), std::min(fy, c - fy)));
+        const int maxRing = std::max(std::max(row, cellRows - 1 - row), std::max(col, cellCols - 1 - col));
+
+        float best = FLT_MAX;
+        for (int r = 0; r <= maxRing; ++r)
+        {
+            const float bound = r == 0 ? 0 : (r - 1) * c + margin;
+            if (best <= bound * bound)
+                break;
+
+            const int rowMin = std::max(row - r, 0), rowMax = std::min(row + r, cellRows - 1);
+            const int colMin = std::max(col - r, 0), colMax = std::min(col + r, cellCols - 1);
+            for (int dy = rowMin; dy <= rowMax; ++dy)
+            {
+                // cells strictly inside the ring have been searched before
+                const bool edgeRow = dy == row - r || dy == row + r;
+                const int step = edgeRow ? 1 : 2*r;
+                for (int dx = edgeRow ? colMin : col - r; dx <= colMax; dx += step)
+                {
+                    if (dx < 0)
+                        continue;
+                    const int cell = dy*cellCols + dx;
+                    for (int i = cellStart[cell]; i < cellStart[cell + 1] && cellEntries[i].rank < rank; ++i)
+                    {
+                        const float ddx = cellEntries[i].x - x, ddy = cellEntries[i].y - y;
+                        best = std::min(best, ddx*ddx + ddy*ddy);
+                    }
+                }
+            }
+        }
+        radius[rank] = best;
+    }
+
+    std::vector<int> ranks(n);
+    std::iota(ranks.begin(), ranks.end(), 0);
+    std::nth_element(ranks.begin(), ranks.begin() + N, ranks.end(),
+            [&radius](int r1, int r2){return radius[r1] > radius[r2] || (radius[r1] == radius[r2] && r1 < r2);});
+    std::sort(ranks.begin(), ranks.begin() + N);
+
+    std::vector<knuff::KeyPoint> reskpts;
+    reskpts.reserve(N);
+    for (int i = 0; i < N; ++i)
+        reskpts.emplace_back(kpts[order[ranks[i]]]);
+    kpts = reskpts;
+}
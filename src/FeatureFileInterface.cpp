@@ -197,6 +197,9 @@ string FeatureFileInterface::GetDistributionName(Distribution::DistributionMetho
         case (distr::SOFT_SSC):
             res.append("Soft SSC");
             break;
+        case (distr::ANMS_EXACT):
+            res.append("Exact-ANMS");
+            break;
         default:
             res.append("unknown");
             break;
@@ -0,0 +1,125 @@
+#include "include/HammingMatcher.h"
+
+#if defined(__AVX2__) || defined(__POPCNT__)
+#include <immintrin.h>
+#endif
+
+
+int HammingMatcher::Distance(const uint64_t* a, const uint64_t* b)
+{
+    int d = 0;
+    for (int w = 0; w < DescriptorStore::ROW_WORDS; ++w)
+        d += __builtin_popcountll(a[w] ^ b[w]);
+    return d;
+}
+
+
+#ifdef __AVX2__
+/** 4 64 bit partial counts of the bits set in x */
+static inline __m256i PopCount64(__m256i x)
+{
+#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512VL__)
+    return _mm256_popcnt_epi64(x);
+#else
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    const __m256i lo = _mm256_and_si256(x, lowNibble);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), lowNibble);
+    const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+#endif
+}
+#endif
+
+
+void HammingMatcher::Distance4(const uint64_t* a, const uint64_t* b0, const uint64_t* b1, const uint64_t* b2,
+                               const uint64_t* b3, int* distances)
+{
+#ifdef __AVX2__
+    const __m256i va = _mm256_load_si256((const __m256i*)a);
+    const __m256i c0 = PopCount64(_mm256_xor_si256(va, _mm256_load_si256((const __m256i*)b0)));
+    const __m256i c1 = PopCount64(_mm256_xor_si256(va, _mm256_load_si256((const __m256i*)b1)));
+    const __m256i c2 = PopCount64(_mm256_xor_si256(va, _mm256_load_si256((const __m256i*)b2)));
+    const __m256i c3 = PopCount64(_mm256_xor_si256(va, _mm256_load_si256((const __m256i*)b3)));
+
+    // partial counts are at most 64, so the 4 rows fit into the 16 bit fields of every lane before summing lanes
+    __m256i packed = _mm256_or_si256(_mm256_or_si256(c0, _mm256_slli_epi64(c1, 16)),
+                                     _mm256_or_si256(_mm256_slli_epi64(c2, 32), _mm256_slli_epi64(c3, 48)));
+    __m128i sum = _mm_add_epi16(_mm256_castsi256_si128(packed), _mm256_extracti128_si256(packed, 1));
+    sum = _mm_add_epi16(sum, _mm_unpackhi_epi64(sum, sum));
+    const auto fields = (uint64_t)_mm_cvtsi128_si64(sum);
+
+    distances[0] = (int)(fields & 0xFFFF);
+    distances[1] = (int)(fields >> 16 & 0xFFFF);
+    distances[2] = (int)(fields >> 32 & 0xFFFF);
+    distances[3] = (int)(fields >> 48);
+#else
+    distances[0] = Distance(a, b0);
+    distances[1] = Distance(a, b1);
+    distances[2] = Distance(a, b2);
+    distances[3] = Distance(a, b3);
+#endif
+}
+
+
+void HammingMatcher::KnnMatch2(const DescriptorStore &query, const DescriptorStore &train,
+                               std::vector<Match> &best)
+{
+    const int nquery = query.Size(), ntrain = train.Size();
+    best.resize(nquery);
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int q = 0; q < nquery; ++q)
+    {
+        const uint64_t* a = query.Words(q);
+        Match m {q, -1, NO_DISTANCE, NO_DISTANCE};
+
+        auto consider = [&m](int t, int d)
+        {
+            if (d < m.distance)
+            {
+                m.secondDistance = m.distance;
+                m.distance = d;
+                m.train = t;
+            }
+            else if (d < m.secondDistance)
+                m.secondDistance = d;
+        };
+
+        int t = 0;
+        for (; t + 4 <= ntrain; t += 4)
+        {
+            int d[4];
+            Distance4(a, train.Words(t), train.Words(t + 1), train.Words(t + 2), train.Words(t + 3), d);
+            consider(t, d[0]);
+            consider(t + 1, d[1]);
+            consider(t + 2, d[2]);
+            consider(t + 3, d[3]);
+        }
+        for (; t < ntrain; ++t)
+            consider(t, Distance(a, train.Words(t)));
+
+        best[q] = m;
+    }
+}
+
+
+void HammingMatcher::RatioMatch(const DescriptorStore &query, const DescriptorStore &train,
+                                std::vector<Match> &matches, float ratio, bool crossCheck, int maxDistance)
+{
+    std::vector<Match> forward, backward;
+    KnnMatch2(query, train, forward);
+    if (crossCheck)
+        KnnMatch2(train, query, backward);
+
+    matches.clear();
+    for (const Match &m : forward)
+    {
+        if (m.train < 0 || m.distance > maxDistance || (float)m.distance >= ratio * (float)m.secondDistance)
+            continue;
+        if (crossCheck && backward[m.train].train != m.query)
+            continue;
+        matches.emplace_back(m);
+    }
+}
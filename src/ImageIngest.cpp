@@ -0,0 +1,425 @@
+#include "include/ImageIngest.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// cv::cvtColor BT.601 weights, 14 bit fixed point
+const int GRAY_SHIFT = 14;
+const int R2Y = 4899;
+const int G2Y = 9617;
+const int B2Y = 1868;
+
+
+ImageIngest::InputFormat ImageIngest::ResolveFormat(InputFormat format, int channels)
+{
+    if (format != AUTO)
+        return format;
+    return channels == 4 ? BGRA : channels == 3 ? BGR : GRAY;
+}
+
+
+cv::Size ImageIngest::OutputSize(const cv::Mat &src, InputFormat format, bool greenHalfResolution)
+{
+    format = ResolveFormat(format, src.channels());
+    if (IsBayer(format) && greenHalfResolution)
+        return cv::Size(src.cols/2, src.rows/2);
+    return cv::Size(src.cols, src.rows);
+}
+
+
+void ImageIngest::ToGray(const cv::Mat &src, cv::Mat &dst, InputFormat format, bool greenHalfResolution,
+                         int firstRow, int lastRow)
+{
+    format = ResolveFormat(format, src.channels());
+    assert(src.depth() == CV_8U && dst.type() == CV_8UC1);
+    assert(dst.size() == OutputSize(src, format, greenHalfResolution));
+
+    const int width = src.cols;
+    const int height = src.rows;
+    if (lastRow < 0)
+        lastRow = dst.rows;
+    assert(0 <= firstRow && firstRow <= lastRow && lastRow <= dst.rows);
+
+    switch (format)
+    {
+        case GRAY:
+        {
+            assert(src.channels() == 1);
+            if (firstRow == 0 && lastRow == dst.rows)
+                src.copyTo(dst);
+            else
+            {
+                cv::Mat dstRows = dst.rowRange(firstRow, lastRow);
+                src.rowRange(firstRow, lastRow).copyTo(dstRows);
+            }
+            break;
+        }
+        case BGR:
+        case RGB:
+        case BGRA:
+        {
+            const int channels = format == BGRA ? 4 : 3;
+            assert(src.channels() == channels);
+#pragma omp parallel for
+            for (int y = firstRow; y < lastRow; ++y)
+            {
+                ColorRowToGray(src.ptr<uchar>(y), dst.ptr<uchar>(y), width, channels, format == RGB);
+            }
+            break;
+        }
+        case BAYER_RGGB:
+        case BAYER_GRBG:
+        {
+            assert(src.channels() == 1 && width > 1 && height > 1);
+            const bool greenFirst = format == BAYER_GRBG;
+            if (greenHalfResolution)
+            {
+#pragma omp parallel for
+                for (int y = firstRow; y < lastRow; ++y)
+                {
+                    BayerRowsToGreen(src.ptr<uchar>(2*y), src.ptr<uchar>(2*y+1), dst.ptr<uchar>(y), dst.cols,
+                                     greenFirst);
+                }
+            }
+            else
+            {
+#pragma omp parallel for
+                for (int y = firstRow; y < lastRow; ++y)
+                {
+                    // BORDER_REFLECT_101 for the first and last row
+                    int up = y > 0 ? y - 1 : 1;
+                    int down = y < height - 1 ? y + 1 : height - 2;
+                    bool redRow = (y % 2 == 0);
+                    bool colorAtEven = (greenFirst != redRow);
+                    BayerRowToGray(src.ptr<uchar>(up), src.ptr<uchar>(y), src.ptr<uchar>(down), dst.ptr<uchar>(y),
+                                   width, redRow, colorAtEven);
+                }
+            }
+            break;
+        }
+        default:
+        {
+            assert(false);
+            break;
+        }
+    }
+}
+
+
+void ImageIngest::ColorRowToGray(const uchar* src, uchar* dst, const int width, const int channels,
+                                 const bool rgbOrder)
+{
+    const int wFirst = rgbOrder ? R2Y : B2Y;
+    const int wLast = rgbOrder ? B2Y : R2Y;
+
+    int x = 0;
+
+#ifdef __SSSE3__
+    // 4 pixels per 16 byte register, expanded to B G R 0 quadruples if the input has 3 channels
+    const __m128i weights = _mm_setr_epi16(wFirst, G2Y, wLast, 0, wFirst, G2Y, wLast, 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (GRAY_SHIFT-1));
+    const __m128i expand3 = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alphaMask = _mm_set1_epi32(0x00FFFFFF);
+
+    // 3 channel loads read 4 bytes past the 16 pixels they use
+    const int end = channels == 3 ? width - 17 : width - 15;
+    for ( ; x < end; x += 16)
+    {
+        __m128i sums[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128i px;
+            if (channels == 3)
+                px = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 3*x + 12*k)), expand3);
+            else
+                px = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 4*x + 16*k)), alphaMask);
+
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), weights);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), weights);
+            sums[k] = _mm_srai_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), round), GRAY_SHIFT);
+        }
+        __m128i gray16lo = _mm_packs_epi32(sums[0], sums[1]);
+        __m128i gray16hi = _mm_packs_epi32(sums[2], sums[3]);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(gray16lo, gray16hi));
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        const uchar* px = src + channels*x;
+        dst[x] = (uchar)((px[0]*wFirst + px[1]*G2Y + px[2]*wLast + (1 << (GRAY_SHIFT-1))) >> GRAY_SHIFT);
+    }
+}
+
+
+/**
+ * Bilinear demosaicing followed by the gray conversion collapses into one 3x3 filter per bayer phase:
+ * gray = (wc*center + wh*(left+right) + wv*(up+down) + wd*(sum of diagonals) + 2^15) >> 16
+ */
+void ImageIngest::BayerRowToGray(const uchar* up, const uchar* mid, const uchar* down, uchar* dst, const int width,
+                                 const bool redRow, const bool colorAtEven)
+{
+    const int wColor = redRow ? R2Y : B2Y;
+    const int wOpposite = redRow ? B2Y : R2Y;
+
+    // weights {center, horizontal, vertical, diagonal} for colour sites and green sites of this row
+    const int colorWeights[4] = {4*wColor, G2Y, G2Y, wOpposite};
+    const int greenWeights[4] = {4*G2Y, 2*wColor, 2*wOpposite, 0};
+
+    auto grayAt = [&](int x, int l, int r)
+    {
+        const int* w = ((x % 2 == 0) == colorAtEven) ? colorWeights : greenWeights;
+        int sum = w[0]*mid[x] + w[1]*(mid[l] + mid[r]) + w[2]*(up[x] + down[x]) +
+                  w[3]*(up[l] + up[r] + down[l] + down[r]);
+        return (uchar)((sum + (1 << (GRAY_SHIFT+1))) >> (GRAY_SHIFT+2));
+    };
+
+    dst[0] = grayAt(0, 1, 1);
+
+    int x = 1;
+
+#ifdef __AVX2__
+    // lane i covers column x+i; x stays odd, so the phase of every lane is fixed
+    __m256i weightVecs[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        int lanes[8];
+        for (int i = 0; i < 8; ++i)
+            lanes[i] = ((1 + i) % 2 == 0) == colorAtEven ? colorWeights[k] : greenWeights[k];
+        weightVecs[k] = _mm256_loadu_si256((const __m256i*)lanes);
+    }
+    const __m256i round = _mm256_set1_epi32(1 << (GRAY_SHIFT+1));
+
+    auto load8 = [](const uchar* p) {return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));};
+
+    for ( ; x < width - 9; x += 8)
+    {
+        __m256i center = load8(mid + x);
+        __m256i horizontal = _mm256_add_epi32(load8(mid + x - 1), load8(mid + x + 1));
+        __m256i vertical = _mm256_add_epi32(load8(up + x), load8(down + x));
+        __m256i diagonal = _mm256_add_epi32(_mm256_add_epi32(load8(up + x - 1), load8(up + x + 1)),
+                                            _mm256_add_epi32(load8(down + x - 1), load8(down + x + 1)));
+
+        __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(center, weightVecs[0]),
+                                       _mm256_mullo_epi32(horizontal, weightVecs[1]));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(vertical, weightVecs[2]));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(diagonal, weightVecs[3]));
+        sum = _mm256_srli_epi32(_mm256_add_epi32(sum, round), GRAY_SHIFT+2);
+
+        __m128i gray16 = _mm_packus_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(gray16, gray16));
+    }
+#endif
+
+    for ( ; x < width - 1; ++x)
+    {
+        dst[x] = grayAt(x, x-1, x+1);
+    }
+    dst[width-1] = grayAt(width-1, width-2, width-2);
+}
+
+
+void ImageIngest::BayerRowsToGreen(const uchar* row0, const uchar* row1, uchar* dst, const int width,
+                                   const bool greenFirst)
+{
+    // greenFirst (GRBG): greens at (0,0) and (1,1) of every cell, otherwise (RGGB) at (0,1) and (1,0)
+    const uchar* evenGreens = greenFirst ? row0 : row1;
+    const uchar* oddGreens = greenFirst ? row1 : row0;
+
+    int x = 0;
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    for ( ; x < width - 15; x += 16)
+    {
+        __m128i e0 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(evenGreens + 2*x)), lowBytes);
+        __m128i e1 = _mm_and_si128(_mm_loadu_si128((const __m128i*)(evenGreens + 2*x + 16)), lowBytes);
+        __m128i o0 = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(oddGreens + 2*x)), 8);
+        __m128i o1 = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(oddGreens + 2*x + 16)), 8);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(_mm_avg_epu16(e0, o0), _mm_avg_epu16(e1, o1)));
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        dst[x] = (uchar)((evenGreens[2*x] + oddGreens[2*x+1] + 1) >> 1);
+    }
+}
+
+
+const int REMAP_BITS = 5;
+const int REMAP_SCALE = 1 << REMAP_BITS;
+
+static void ReadMatrix3x3(const cv::Mat &m, double out[9], bool identityIfEmpty)
+{
+    for (int i = 0; i < 9; ++i)
+        out[i] = (identityIfEmpty && i % 4 == 0) ? 1. : 0.;
+    if (m.empty())
+        return;
+
+    cv::Mat md;
+    m.convertTo(md, CV_64F);
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            out[3*r + c] = md.at<double>(r, c);
+}
+
+static void Invert3x3(const double m[9], double inv[9])
+{
+    double c0 = m[4]*m[8] - m[5]*m[7];
+    double c1 = m[5]*m[6] - m[3]*m[8];
+    double c2 = m[3]*m[7] - m[4]*m[6];
+    double invDet = 1. / (m[0]*c0 + m[1]*c1 + m[2]*c2);
+
+    inv[0] = c0*invDet;
+    inv[1] = (m[2]*m[7] - m[1]*m[8])*invDet;
+    inv[2] = (m[1]*m[5] - m[2]*m[4])*invDet;
+    inv[3] = c1*invDet;
+    inv[4] = (m[0]*m[8] - m[2]*m[6])*invDet;
+    inv[5] = (m[2]*m[3] - m[0]*m[5])*invDet;
+    inv[6] = c2*invDet;
+    inv[7] = (m[1]*m[6] - m[0]*m[7])*invDet;
+    inv[8] = (m[0]*m[4] - m[1]*m[3])*invDet;
+}
+
+
+void ImageIngest::BuildUndistortionLUT(const cv::Mat &K, const cv::Mat &distCoeffs, const cv::Mat &R,
+                                       const cv::Mat &P, const cv::Size size, const int srcStep, RemapLUT &lut)
+{
+    double k[9], rot[9], newK[9];
+    ReadMatrix3x3(K, k, false);
+    ReadMatrix3x3(R, rot, true);
+    ReadMatrix3x3(P.empty() ? K : P, newK, false);
+
+    double d[5] = {0, 0, 0, 0, 0};
+    if (!distCoeffs.empty())
+    {
+        cv::Mat dd;
+        distCoeffs.convertTo(dd, CV_64F);
+        for (int i = 0; i < std::min(5, (int)dd.total()); ++i)
+            d[i] = dd.at<double>(i);
+    }
+    const double k1 = d[0], k2 = d[1], p1 = d[2], p2 = d[3], k3 = d[4];
+
+    // rectified pixel -> ray in the original camera frame: inverse of newK * R
+    double newKR[9], iR[9];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            newKR[3*r + c] = newK[3*r]*rot[c] + newK[3*r + 1]*rot[3 + c] + newK[3*r + 2]*rot[6 + c];
+    Invert3x3(newKR, iR);
+
+    const int width = size.width;
+    const int height = size.height;
+    lut.size = size;
+    lut.srcStep = srcStep;
+    lut.offsets.resize((size_t)width * height);
+    lut.weights.resize((size_t)width * height);
+    lut.scalarRows.assign(height, 0);
+
+#pragma omp parallel for
+    for (int v = 0; v < height; ++v)
+    {
+        double X = iR[1]*v + iR[2], Y = iR[4]*v + iR[5], W = iR[7]*v + iR[8];
+        for (int u = 0; u < width; ++u, X += iR[0], Y += iR[3], W += iR[6])
+        {
+            double x = X/W, y = Y/W;
+            double x2 = x*x, y2 = y*y, xy2 = 2*x*y, r2 = x2 + y2;
+            double radial = 1 + r2*(k1 + r2*(k2 + r2*k3));
+            double sx = k[0]*(x*radial + p1*xy2 + p2*(r2 + 2*x2)) + k[2];
+            double sy = k[4]*(y*radial + p1*(r2 + 2*y2) + p2*xy2) + k[5];
+
+            int ix = (int)std::floor(sx * REMAP_SCALE + 0.5);
+            int iy = (int)std::floor(sy * REMAP_SCALE + 0.5);
+            ix = std::min(std::max(ix, 0), (width - 1) * REMAP_SCALE);
+            iy = std::min(std::max(iy, 0), (height - 1) * REMAP_SCALE);
+
+            // the top left sample stays inside, a weight of 32 selects its right/lower neighbour exclusively
+            int x0 = std::min(ix >> REMAP_BITS, width - 2);
+            int y0 = std::min(iy >> REMAP_BITS, height - 2);
+            int fx = ix - x0 * REMAP_SCALE;
+            int fy = iy - y0 * REMAP_SCALE;
+
+            size_t idx = (size_t)v*width + u;
+            lut.offsets[idx] = y0*srcStep + x0;
+            lut.weights[idx] = (ushort)(fx | (fy << 6));
+
+            // vectorised rows load 4 bytes per sample, which must not run past the last source row
+            if (y0 == height - 2 && x0 > width - 4)
+                lut.scalarRows[v] = 1;
+        }
+    }
+}
+
+
+void ImageIngest::Remap(const cv::Mat &src, cv::Mat &dst, const RemapLUT &lut, int firstRow, int lastRow)
+{
+    assert(src.type() == CV_8UC1 && dst.type() == CV_8UC1);
+    assert(lut.Matches(src.size(), (int)src.step) && dst.size() == lut.size);
+
+    const int width = lut.size.width;
+    if (lastRow < 0)
+        lastRow = lut.size.height;
+
+#pragma omp parallel for
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        size_t idx = (size_t)y*width;
+        RemapRow(src.data, dst.ptr<uchar>(y), &lut.offsets[idx], &lut.weights[idx], (int)src.step, width,
+                 lut.scalarRows[y] != 0);
+    }
+}
+
+
+void ImageIngest::RemapRow(const uchar* src, uchar* dst, const int* offsets, const ushort* weights, const int srcStep,
+                           const int width, const bool scalarOnly)
+{
+    const int round = 1 << (2*REMAP_BITS - 1);
+    int x = 0;
+
+#ifdef __AVX2__
+    if (!scalarOnly)
+    {
+        const __m256i byteMask = _mm256_set1_epi32(0xFF);
+        const __m256i sixBits = _mm256_set1_epi32(0x3F);
+        const __m256i full = _mm256_set1_epi32(REMAP_SCALE);
+        const __m256i roundVec = _mm256_set1_epi32(round);
+        const __m256i stepVec = _mm256_set1_epi32(srcStep);
+
+        for ( ; x < width - 7; x += 8)
+        {
+            __m256i off = _mm256_loadu_si256((const __m256i*)(offsets + x));
+            __m256i top = _mm256_i32gather_epi32((const int*)src, off, 1);
+            __m256i bottom = _mm256_i32gather_epi32((const int*)src, _mm256_add_epi32(off, stepVec), 1);
+
+            __m256i w = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(weights + x)));
+            __m256i fx = _mm256_and_si256(w, sixBits);
+            __m256i fy = _mm256_srli_epi32(w, 6);
+            __m256i ifx = _mm256_sub_epi32(full, fx);
+
+            __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(top, byteMask), ifx),
+                                         _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(top, 8), byteMask), fx));
+            __m256i b = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(bottom, byteMask), ifx),
+                                         _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(bottom, 8), byteMask), fx));
+            __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(t, _mm256_sub_epi32(full, fy)), _mm256_mullo_epi32(b, fy));
+            sum = _mm256_srli_epi32(_mm256_add_epi32(sum, roundVec), 2*REMAP_BITS);
+
+            __m128i val16 = _mm_packus_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(val16, val16));
+        }
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        const uchar* p = src + offsets[x];
+        int fx = weights[x] & 0x3F, fy = weights[x] >> 6;
+        int t = p[0]*(REMAP_SCALE - fx) + p[1]*fx;
+        int b = p[srcStep]*(REMAP_SCALE - fx) + p[srcStep + 1]*fx;
+        dst[x] = (uchar)((t*(REMAP_SCALE - fy) + b*fy + round) >> (2*REMAP_BITS));
+    }
+}
@@ -0,0 +1,60 @@
+#include "include/MappedFile.h"
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+bool MappedFile::Open(const std::string &filename)
+{
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open " << filename << "...\n";
+        return false;
+    }
+
+    struct stat st{};
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    data = (uchar*)p;
+    size = (size_t)st.st_size;
+    return true;
+}
+
+
+void MappedFile::Close()
+{
+    if (data)
+        munmap(data, size);
+    data = nullptr;
+    size = 0;
+}
+
+
+bool MappedFile::Write(const std::string &filename, const std::vector<std::pair<const void*, size_t>> &sections)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << filename << "...\n";
+        return false;
+    }
+
+    static const char zeros[ALIGNMENT] = {};
+    for (const auto &section : sections)
+    {
+        file.write((const char*)section.first, (std::streamsize)section.second);
+        file.write(zeros, (std::streamsize)(Padded(section.second) - section.second));
+    }
+    return file.good();
+}
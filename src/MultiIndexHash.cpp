@@ -0,0 +1,363 @@
+#include "include/MultiIndexHash.h"
+#include "include/HammingMatcher.h"
+#include "include/FeatureFileInterface.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+const char FILE_MAGIC[8] = {'O', 'R', 'B', 'M', 'I', 'H', '1', '\0'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t substrings;
+    uint32_t reserved;
+    uint64_t n;
+    uint64_t nframes;
+};
+
+/** byte offsets of descriptors, frame starts, bucket offsets and ids in the file, followed by the file size */
+void FileLayout(uint64_t n, uint64_t nframes, size_t sections[5])
+{
+    sections[0] = MappedFile::Padded(sizeof(FileHeader));
+    sections[1] = sections[0] + MappedFile::Padded(n * DescriptorStore::ROW_BYTES);
+    sections[2] = sections[1] + MappedFile::Padded((nframes + 1) * sizeof(uint64_t));
+    sections[3] = sections[2] +
+                  MappedFile::Padded((size_t)MultiIndexHash::SUBSTRINGS * (MultiIndexHash::BUCKETS + 1) * 4);
+    sections[4] = sections[3] + MappedFile::Padded((size_t)MultiIndexHash::SUBSTRINGS * n * 4);
+}
+
+/** all 16 bit masks with s bits set, for s = 0..16 */
+const std::vector<uint16_t>& Masks(int s)
+{
+    static const std::vector<std::vector<uint16_t>> masks = []()
+    {
+        std::vector<std::vector<uint16_t>> m(17);
+        for (int mask = 0; mask < MultiIndexHash::BUCKETS; ++mask)
+            m[__builtin_popcount(mask)].emplace_back((uint16_t)mask);
+        return m;
+    }();
+    return masks[s];
+}
+
+bool Closer(const MultiIndexHash::Neighbour &a, const MultiIndexHash::Neighbour &b)
+{
+    return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+}
+
+}
+
+
+MultiIndexHash::MultiIndexHash() :
+        n(0), nframes(0), descriptors(nullptr), frameStart(nullptr), offsets(nullptr), ids(nullptr)
+{
+}
+
+
+MultiIndexHash::~MultiIndexHash()
+{
+    Release();
+}
+
+
+void MultiIndexHash::Release()
+{
+    mapped.Close();
+
+    ownedDescriptors.clear();
+    ownedFrameStart.clear();
+    ownedOffsets.clear();
+    ownedIds.clear();
+    n = nframes = 0;
+    descriptors = frameStart = nullptr;
+    offsets = ids = nullptr;
+}
+
+
+void MultiIndexHash::Build(const cv::Mat &_descriptors, const std::vector<uint64_t> &_frameStart)
+{
+    Release();
+    n = _descriptors.empty() ? 0 : (uint64_t)_descriptors.rows;
+    message_assert("Descriptors must be CV_8U with 32 columns!",
+                   n == 0 || (_descriptors.type() == CV_8U && _descriptors.cols == DescriptorStore::ROW_BYTES));
+    message_assert("Too many descriptors for 32 bit ids!", n < ((uint64_t)1 << 32));
+
+    ownedDescriptors.resize(n * DescriptorStore::ROW_WORDS);
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        memcpy(&ownedDescriptors[i * DescriptorStore::ROW_WORDS], _descriptors.ptr((int)i),
+               DescriptorStore::ROW_BYTES);
+    }
+
+    if (_frameStart.empty())
+        ownedFrameStart = {0, n};
+    else
+        ownedFrameStart = _frameStart;
+    nframes = ownedFrameStart.size() - 1;
+
+    ownedOffsets.assign((size_t)SUBSTRINGS * (BUCKETS + 1), 0);
+    ownedIds.resize((size_t)SUBSTRINGS * n);
+
+    // counting sort of all ids by their substring, one table per iteration
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < SUBSTRINGS; ++t)
+    {
+        uint32_t* tableOffsets = &ownedOffsets[(size_t)t * (BUCKETS + 1)];
+        uint32_t* tableIds = ownedIds.data() + (size_t)t * n;
+        auto substring = [&](uint64_t i)
+        {
+            return ((const uint16_t*)&ownedDescriptors[i * DescriptorStore::ROW_WORDS])[t];
+        };
+
+        for (uint64_t i = 0; i < n; ++i)
+            ++tableOffsets[substring(i) + 1];
+        for (int b = 0; b < BUCKETS; ++b)
+            tableOffsets[b + 1] += tableOffsets[b];
+
+        std::vector<uint32_t> cursor(tableOffsets, tableOffsets + BUCKETS);
+        for (uint64_t i = 0; i < n; ++i)
+            tableIds[cursor[substring(i)]++] = (uint32_t)i;
+    }
+
+    descriptors = ownedDescriptors.data();
+    frameStart = ownedFrameStart.data();
+    offsets = ownedOffsets.data();
+    ids = ownedIds.data();
+}
+
+
+bool MultiIndexHash::BuildFromSequence(std::string path)
+{
+    FeatureFileInterface files;
+    std::vector<uchar> bytes;
+    std::vector<uint64_t> starts;
+
+    for (int f = 0; ; ++f)
+    {
+        std::string featurePath = path + "features/" + std::to_string(f) + ".orbf";
+        if (!files.CheckExistence(featurePath))
+            break;
+
+        files.SetCurrentImage(f);
+        std::vector<knuff::KeyPoint> kpts = files.LoadFeatures(path);
+        starts.emplace_back(bytes.size() / DescriptorStore::ROW_BYTES);
+        if (kpts.empty())
+            continue;
+
+        cv::Mat frameDescriptors((int)kpts.size(), DescriptorStore::ROW_BYTES, CV_8U);
+        files.LoadDescriptors(path, frameDescriptors, (int)kpts.size());
+        bytes.insert(bytes.end(), frameDescriptors.data, frameDescriptors.data + frameDescriptors.total());
+    }
+
+    if (starts.empty())
+        return false;
+
+    starts.emplace_back(bytes.size() / DescriptorStore::ROW_BYTES);
+    cv::Mat all((int)starts.back(), DescriptorStore::ROW_BYTES, CV_8U, bytes.data());
+    Build(all, starts);
+    return true;
+}
+
+
+bool MultiIndexHash::Save(const std::string &filename) const
+{
+    FileHeader header{};
+    memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.substrings = SUBSTRINGS;
+    header.n = n;
+    header.nframes = nframes;
+
+    return MappedFile::Write(filename, {{&header, sizeof(header)},
+                                        {descriptors, n * DescriptorStore::ROW_BYTES},
+                                        {frameStart, (nframes + 1) * sizeof(uint64_t)},
+                                        {offsets, (size_t)SUBSTRINGS * (BUCKETS + 1) * 4},
+                                        {ids, (size_t)SUBSTRINGS * n * 4}});
+}
+
+
+bool MultiIndexHash::Load(const std::string &filename)
+{
+    Release();
+    if (!mapped.Open(filename))
+        return false;
+
+    const auto header = (const FileHeader*)mapped.Data();
+    size_t sections[5] = {};
+    bool valid = mapped.Size() >= sizeof(FileHeader) && memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 &&
+                 header->substrings == SUBSTRINGS;
+    if (valid)
+    {
+        FileLayout(header->n, header->nframes, sections);
+        valid = sections[4] <= mapped.Size();
+    }
+    if (!valid)
+    {
+        std::cerr << filename << " is not a multi-index hash file...\n";
+        Release();
+        return false;
+    }
+
+    const uchar* base = mapped.Data();
+    n = header->n;
+    nframes = header->nframes;
+    descriptors = (const uint64_t*)(base + sections[0]);
+    frameStart = (const uint64_t*)(base + sections[1]);
+    offsets = (const uint32_t*)(base + sections[2]);
+    ids = (const uint32_t*)(base + sections[3]);
+    return true;
+}
+
+
+uint64_t MultiIndexHash::Frame(uint32_t id) const
+{
+    return (uint64_t)(std::upper_bound(frameStart, frameStart + nframes + 1, (uint64_t)id) - frameStart) - 1;
+}
+
+
+template <typename Visit>
+bool MultiIndexHash::Probe(const uint64_t* query, int s, Scratch &scratch, Visit visit) const
+{
+    auto mark = [&scratch](uint32_t id)
+    {
+        uint64_t &word = scratch.visited[id >> 6];
+        const uint64_t bit = (uint64_t)1 << (id & 63);
+        if (word & bit)
+            return false;
+        if (!word)
+            scratch.touched.emplace_back(id >> 6);
+        word |= bit;
+        return true;
+    };
+
+    const std::vector<uint16_t> &masks = Masks(s);
+    if ((scratch.candidates + masks.size() * SUBSTRINGS) * RANDOM_ACCESS_COST > n)
+    {
+        // the scan ends the query, so visited ids are skipped without being marked
+        for (uint64_t id = 0; id < n; ++id)
+        {
+            if (!(scratch.visited[id >> 6] >> (id & 63) & 1))
+                visit((uint32_t)id);
+        }
+        return true;
+    }
+
+    const auto substrings = (const uint16_t*)query;
+    for (int t = 0; t < SUBSTRINGS; ++t)
+    {
+        const uint32_t* tableOffsets = offsets + (size_t)t * (BUCKETS + 1);
+        const uint32_t* tableIds = ids + (size_t)t * n;
+        for (uint16_t mask : masks)
+        {
+            const int bucket = substrings[t] ^ mask;
+            for (uint32_t j = tableOffsets[bucket]; j < tableOffsets[bucket + 1]; ++j)
+            {
+                if (mark(tableIds[j]))
+                {
+                    visit(tableIds[j]);
+                    ++scratch.candidates;
+                }
+            }
+        }
+    }
+    return s == SUBSTRINGS;
+}
+
+
+void MultiIndexHash::Knn(const uint64_t* query, int k, Scratch &scratch, std::vector<Neighbour> &result) const
+{
+    result.clear();
+    if (k <= 0 || n == 0)
+        return;
+
+    // max heap of the k closest so far
+    auto visit = [&](uint32_t id)
+    {
+        const Neighbour candidate {id, HammingMatcher::Distance(query, Descriptor(id))};
+        if ((int)result.size() < k)
+        {
+            result.emplace_back(candidate);
+            std::push_heap(result.begin(), result.end(), Closer);
+        }
+        else if (Closer(candidate, result.front()))
+        {
+            std::pop_heap(result.begin(), result.end(), Closer);
+            result.back() = candidate;
+            std::push_heap(result.begin(), result.end(), Closer);
+        }
+    };
+
+    for (int s = 0; s <= SUBSTRINGS; ++s)
+    {
+        if (Probe(query, s, scratch, visit))
+            break;
+        // every descriptor within SUBSTRINGS*(s+1)-1 has been visited
+        if ((int)result.size() == k && result.front().distance < SUBSTRINGS*(s + 1))
+            break;
+    }
+    std::sort_heap(result.begin(), result.end(), Closer);
+
+    for (uint32_t word : scratch.touched)
+        scratch.visited[word] = 0;
+    scratch.touched.clear();
+    scratch.candidates = 0;
+}
+
+
+void MultiIndexHash::Radius(const uint64_t* query, int radius, Scratch &scratch,
+                            std::vector<Neighbour> &result) const
+{
+    result.clear();
+    auto visit = [&](uint32_t id)
+    {
+        const int d = HammingMatcher::Distance(query, Descriptor(id));
+        if (d <= radius)
+            result.push_back({id, d});
+    };
+
+    const int maxS = std::min(std::max(radius, 0) / SUBSTRINGS, SUBSTRINGS);
+    for (int s = 0; s <= maxS; ++s)
+    {
+        if (Probe(query, s, scratch, visit))
+            break;
+    }
+    std::sort(result.begin(), result.end(), Closer);
+
+    for (uint32_t word : scratch.touched)
+        scratch.visited[word] = 0;
+    scratch.touched.clear();
+    scratch.candidates = 0;
+}
+
+
+void MultiIndexHash::KnnSearch(const DescriptorStore &queries, int k,
+                               std::vector<std::vector<Neighbour>> &results) const
+{
+    results.resize(queries.Size());
+#pragma omp parallel
+    {
+        Scratch scratch;
+        scratch.visited.assign(n / 64 + 1, 0);
+#pragma omp for schedule(dynamic, 8)
+        for (int q = 0; q < queries.Size(); ++q)
+            Knn(queries.Words(q), k, scratch, results[q]);
+    }
+}
+
+
+void MultiIndexHash::RadiusSearch(const DescriptorStore &queries, int radius,
+                                  std::vector<std::vector<Neighbour>> &results) const
+{
+    results.resize(queries.Size());
+#pragma omp parallel
+    {
+        Scratch scratch;
+        scratch.visited.assign(n / 64 + 1, 0);
+#pragma omp for schedule(dynamic, 8)
+        for (int q = 0; q < queries.Size(); ++q)
+            Radius(queries.Words(q), radius, scratch, results[q]);
+    }
+}
@@ -1,11 +1,14 @@
 #include <string>
 #include <iostream>
 #include <iterator>
+#include <algorithm>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "include/ORBextractor.h"
 #include "include/ORBconstants.h"
 #include <unistd.h>
 #include <chrono>
+#include <future>
+#include <omp.h>
 
 
 #ifndef NDEBUG
@@ -32,6 +35,15 @@
 namespace ORB_SLAM2
 {
 
+static size_t L2CacheBytes()
+{
+    long bytes = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return bytes > 0 ? (size_t)bytes : (size_t)256*1024;
+}
+
 float ORBextractor::IntensityCentroidAngle(const uchar* pointer, int step)
 {
     //m10 ~ x^1y^0, m01 ~ x^0y^1
@@ -62,10 +74,20 @@ float ORBextractor::IntensityCentroidAngle(const uchar* pointer, int step)
 }
 
 
-ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int _iniThFAST, int _minThFAST):
+ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int _iniThFAST, int _minThFAST,
+                           int _descriptorBits):
         nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels), iniThFAST(_iniThFAST),
-        minThFAST(_minThFAST), stepsChanged(true), levelToDisplay(-1), softSSCThreshold(10), prevDims(-1, -1),
-        kptDistribution(Distribution::DistributionMethod::SSC), pixelOffset{}, fast(_iniThFAST, _minThFAST, _nlevels),
+        minThFAST(_minThFAST), descriptorBits(_descriptorBits), stepsChanged(true), wrapPaddedInput(false),
+        bayerGreenHalfResolution(false), halfResolutionLevel0(false), undistortInput(false),
+        octaveAnchoredPyramid(false), stripedLevel0(false), stripeRows(0), level0Wrapped(false),
+        level0Detected(false), level0Blurred(false), frameId(0), levelToDisplay(-1), softSSCThreshold(10), prevDims(-1, -1),
+        kptDistribution(Distribution::DistributionMethod::SSC), blurMode(PyramidBlur::AUTO),
+        descriptorSmoothing(BRIEF::GAUSSIAN), prefetchFootprints(true),
+        orientationMethod(Orientation::SCALAR), orientationTolerance(0.001f),
+        orientationBins(0), useDescriptorCache(false),
+        inputFormat(ImageIngest::AUTO), level0Format(ImageIngest::GRAY),
+        undistortLUTHalfResolution(false), pixelOffset{},
+        fast(_iniThFAST, _minThFAST, _nlevels),
         fileInterface(), saveFeatures(false), usePrecomputedFeatures(false), timeVector{}
 {
     SetnLevels(_nlevels);
@@ -74,9 +96,19 @@ ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int
 
     SetnFeatures(nfeatures);
 
-    const int nPoints = 512;
+    message_assert("Descriptor length must be 128, 256 or 512 bits!",
+                   descriptorBits == 128 || descriptorBits == 256 || descriptorBits == 512);
+
+    // shorter descriptors use the first (least correlated) tests of the learned pattern, longer ones extend it
+    const int nPoints = 2*std::min(descriptorBits, 256);
     const auto tempPattern = (const cv::Point*) bit_pattern_31_;
     std::copy(tempPattern, tempPattern+nPoints, std::back_inserter(pattern));
+    if (descriptorBits > 256)
+    {
+        const auto extension = (const cv::Point*) bit_pattern_31_extension_;
+        std::copy(extension, extension + 2*(descriptorBits - 256), std::back_inserter(pattern));
+    }
+    briefPattern = BRIEF::Pattern(pattern.data(), descriptorBits);
 }
 
 void ORBextractor::SetnFeatures(int n)
@@ -118,7 +150,7 @@ void ORBextractor::operator()(cv::InputArray inputImage, cv::InputArray mask,
 }
 
 /** @overload
- * @param inputImage single channel img-matrix
+ * @param inputImage 8-bit gray, colour or bayer img-matrix, see SetInputFormat
  * @param mask ignored
  * @param resultKeypoints keypoint vector in which results will be stored
  * @param outputDescriptors matrix in which descriptors will be stored
@@ -140,7 +172,7 @@ void ORBextractor::operator()(cv::InputArray inputImage, cv::InputArray mask,
         }
         else
         {
-            outputDescriptors.create(nkpts, 32, CV_8U);
+            outputDescriptors.create(nkpts, GetDescriptorBytes(), CV_8U);
             BRIEFdescriptors = outputDescriptors.getMat();
         }
 
@@ -154,17 +186,224 @@ void ORBextractor::operator()(cv::InputArray inputImage, cv::InputArray mask,
         return;
 
     cv::Mat image = inputImage.getMat();
-    message_assert("Image must be single-channel!",image.type() == CV_8UC1);
+    BuildPyramid(image);
+
+    // the blurred pyramid is only needed for descriptors, so it is computed while FAST runs; a new thread starts
+    // with the default team size, so it gets the one of the caller (e.g. half of the threads in StereoExtractor)
+    const int threads = omp_get_max_threads();
+    std::future<void> blurredPyramidDone = std::async(std::launch::async, [this, threads]()
+    {
+        omp_set_num_threads(threads);
+        ComputeBlurredPyramid();
+    });
+
+    std::vector<std::vector<knuff::KeyPoint>> allkpts;
+    DetectAndDistribute(allkpts, distributePerLevel, true);
+
+    cv::Mat BRIEFdescriptors;
+    int nkpts = 0;
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        nkpts += (int)allkpts[lvl].size();
+    }
+    if (nkpts <= 0)
+    {
+        outputDescriptors.release();
+    }
+    else
+    {
+        outputDescriptors.create(nkpts, GetDescriptorBytes(), CV_8U);
+        BRIEFdescriptors = outputDescriptors.getMat();
+    }
+
+    blurredPyramidDone.get();
+
+    BlurSparseLevels(allkpts);
+
+    ComputeDescriptors(allkpts, BRIEFdescriptors, nullptr, useDescriptorCache ? &descriptorCache : nullptr);
+
+    ToImageCoordinates(allkpts, resultKeypoints);
 
+    if (saveFeatures)
+    {
+        fileInterface.SaveFeatures(resultKeypoints);
+        fileInterface.SaveDescriptors(BRIEFdescriptors);
+    }
+
+    //ensure feature detection always takes 50ms
+    unsigned long maxDuration = 50000;
+    std::chrono::high_resolution_clock::time_point funcExit = std::chrono::high_resolution_clock::now();
+    auto funcDuration = std::chrono::duration_cast<std::chrono::microseconds>(funcExit-funcEntry).count();
+    //assert(funcDuration <= maxDuration);
+    //if (funcDuration < maxDuration)
+    //{
+    //    auto sleeptime = maxDuration - funcDuration;
+    //    usleep(sleeptime);
+    //}
+}
+
+
+/**
+ * Detection only: keypoints are returned in frame at once, without descriptors and (unless computeAngles) without
+ * angles. Pyramid and blurred pyramid stay alive for LazyFrame::Describe until frame is released or this
+ * extractor processes the next image. No level is blurred here, see LazyFrame::Describe.
+ */
+void ORBextractor::Detect(cv::InputArray inputImage, cv::InputArray mask, LazyFrame &frame, bool distributePerLevel,
+                          bool computeAngles)
+{
+    frame.Release();
+    if (inputImage.empty())
+        return;
+
+    cv::Mat image = inputImage.getMat();
+    BuildPyramid(image);
+    DetectAndDistribute(frame.levelKpts, distributePerLevel, computeAngles);
+
+    frame.extractor = this;
+    frame.id = frameId;
+    // the striped pipeline may already have blurred level 0 completely
+    frame.fullyBlurred.assign(nlevels, false);
+    frame.blurPrepared.assign(nlevels, false);
+    frame.fullyBlurred[0] = frame.blurPrepared[0] = level0Blurred;
+
+    ToImageCoordinates(frame.levelKpts, frame.keypoints);
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        for (size_t k = 0; k < frame.levelKpts[lvl].size(); ++k)
+            frame.levelIndex.emplace_back(lvl, (int)k);
+    }
+}
+
+
+void ORBextractor::LazyFrame::Release()
+{
+    extractor = nullptr;
+    keypoints.clear();
+    levelKpts.clear();
+    levelIndex.clear();
+}
+
+
+/**
+ * Rows of descriptors follow indices. Missing angles of the requested keypoints are computed first and kept.
+ * Every level is blurred at most once in full: for a batch whose keypoints are sparse on their level (see
+ * PyramidBlur::PreferSparse) only their BRIEF footprints are blurred, otherwise the whole level. With BRIEF::BOX
+ * smoothing the integral image of a level is built with its first batch instead.
+ */
+void ORBextractor::LazyFrame::Describe(const std::vector<int> &indices, cv::OutputArray outputDescriptors)
+{
+    if (indices.empty())
+    {
+        outputDescriptors.release();
+        return;
+    }
+    message_assert("Frame was released or its extractor processed another image!", IsValid());
+
+    ORBextractor &ex = *extractor;
+    std::vector<std::vector<knuff::KeyPoint>> batch(ex.nlevels), unoriented(ex.nlevels);
+    std::vector<std::vector<int>> rows(ex.nlevels);
+    for (int i = 0; i < (int)indices.size(); ++i)
+    {
+        message_assert("Keypoint index out of range!", indices[i] >= 0 && indices[i] < (int)keypoints.size());
+        const std::pair<int, int> &li = levelIndex[indices[i]];
+        const knuff::KeyPoint &kpt = levelKpts[li.first][li.second];
+        if (kpt.angle < 0)
+            unoriented[li.first].emplace_back(kpt);
+        batch[li.first].emplace_back(kpt);
+        rows[li.first].emplace_back(i);
+    }
+
+    ex.ComputeAngles(unoriented);
+    for (int lvl = 0; lvl < ex.nlevels; ++lvl)
+    {
+        auto oriented = unoriented[lvl].begin();
+        for (size_t k = 0; k < batch[lvl].size(); ++k)
+        {
+            if (batch[lvl][k].angle >= 0)
+                continue;
+            const std::pair<int, int> &li = levelIndex[indices[rows[lvl][k]]];
+            batch[lvl][k].angle = oriented->angle;
+            levelKpts[li.first][li.second].angle = oriented->angle;
+            keypoints[indices[rows[lvl][k]]].angle = (oriented++)->angle;
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int lvl = 0; lvl < ex.nlevels; ++lvl)
+    {
+        ex.sparseBlurLevels[lvl] = false;
+        if (batch[lvl].empty() || fullyBlurred[lvl])
+            continue;
+
+        if (ex.descriptorSmoothing == BRIEF::BOX)
+        {
+            ex.ComputeBoxSums(lvl);
+            fullyBlurred[lvl] = true;
+            continue;
+        }
+
+        if (!blurPrepared[lvl])
+        {
+            ex.PrepareBlurredLevel(lvl);
+            blurPrepared[lvl] = true;
+        }
+        ex.sparseBlurLevels[lvl] = ex.BlurLevelSparse(lvl, (int)batch[lvl].size());
+        if (ex.sparseBlurLevels[lvl])
+            continue;
+
+        PyramidBlur::Gaussian7x7(ex.imagePyramid[lvl], ex.blurredPyramid[lvl], ex.blurRowBuffers[lvl]);
+        MakeBorderReflect101(ex.blurredPyramid[lvl], EDGE_THRESHOLD);
+        fullyBlurred[lvl] = true;
+    }
+    ex.BlurSparseLevels(batch);
+
+    std::vector<int> descriptorRows;
+    descriptorRows.reserve(indices.size());
+    for (int lvl = 0; lvl < ex.nlevels; ++lvl)
+        descriptorRows.insert(descriptorRows.end(), rows[lvl].begin(), rows[lvl].end());
+
+    outputDescriptors.create((int)indices.size(), ex.GetDescriptorBytes(), CV_8U);
+    cv::Mat descriptors = outputDescriptors.getMat();
+    ex.ComputeDescriptors(batch, descriptors, &descriptorRows);
+}
+
+
+void ORBextractor::BuildPyramid(cv::Mat &image)
+{
+    message_assert("Image must be 8-bit!", image.depth() == CV_8U);
+
+    ++frameId;
     if (prevDims.x != image.cols || prevDims.y != image.rows)
+    {
         stepsChanged = true;
+        prevDims = knuff::Point(image.cols, image.rows);
+    }
 
-    ComputeScalePyramid(image);
+    level0Detected = false;
+    level0Blurred = false;
 
-    SetSteps();
+    if (stripedLevel0)
+    {
+        AllocateScalePyramid(image);
+        SetSteps();
+        ComputeLevel0Striped(image, 30);
+        ComputeUpperLevels();
+    }
+    else
+    {
+        ComputeScalePyramid(image);
+        SetSteps();
+    }
+}
 
-    std::vector<std::vector<knuff::KeyPoint>> allkpts;
 
+/**
+ * FAST and distribution on the built pyramid, allkpts in level coordinates. Distribution does not use angles,
+ * so they are computed for the survivors only.
+ */
+void ORBextractor::DetectAndDistribute(std::vector<std::vector<knuff::KeyPoint>> &allkpts, bool distributePerLevel,
+                                       bool computeAngles)
+{
     //using namespace std::chrono;
     //high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
@@ -172,21 +411,12 @@ void ORBextractor::operator()(cv::InputArray inputImage, cv::InputArray mask,
 
     if (!distributePerLevel)
     {
-        ComputeAngles(allkpts);
         int lvl;
-        int nkpts = 0;
-        for (lvl = 0; lvl < nlevels; ++lvl)
+        for (lvl = 1; lvl < nlevels; ++lvl)
         {
-            nkpts += allkpts[lvl].size();
-
-            float size = PATCH_SIZE * scaleFactorVec[lvl];
             float scale = scaleFactorVec[lvl];
             for (auto &kpt : allkpts[lvl])
-            {
-                kpt.size = size;
-                if (lvl)
-                    kpt.pt *= scale;
-            }
+                kpt.pt *= scale;
         }
 
         auto temp = allkpts[0];
@@ -200,73 +430,162 @@ void ORBextractor::operator()(cv::InputArray inputImage, cv::InputArray mask,
         for (lvl = 0; lvl < nlevels; ++lvl)
             allkpts[lvl].clear();
 
+        // descriptors are computed on the level images, so survivors go back to level coordinates
         for (auto &kpt : temp)
         {
+            if (kpt.octave)
+                kpt.pt *= invScaleFactorVec[kpt.octave];
             allkpts[kpt.octave].emplace_back(kpt);
         }
     }
 
-    if (distributePerLevel)
+    if (computeAngles)
         ComputeAngles(allkpts);
+}
 
 
-    cv::Mat BRIEFdescriptors;
-    int nkpts = 0;
+/** level coordinates of allkpts to pixel coordinates of the input, concatenated level by level */
+void ORBextractor::ToImageCoordinates(const std::vector<std::vector<knuff::KeyPoint>> &allkpts,
+                                      std::vector<knuff::KeyPoint> &resultKeypoints)
+{
+    resultKeypoints.clear();
     for (int lvl = 0; lvl < nlevels; ++lvl)
     {
-        nkpts += (int)allkpts[lvl].size();
+        const float size = PATCH_SIZE * scaleFactorVec[lvl];
+        const float scale = scaleFactorVec[lvl];
+        for (knuff::KeyPoint kpt : allkpts[lvl])
+        {
+            kpt.size = size;
+            if (lvl)
+                kpt.pt *= scale;
+            resultKeypoints.emplace_back(kpt);
+        }
     }
-    if (nkpts <= 0)
+
+    if (halfResolutionLevel0)
+    {
+        // green samples were averaged over 2x2 bayer cells, whose centers lie at 2*pt + 0.5
+        for (auto &kpt : resultKeypoints)
+        {
+            kpt.pt.x = 2.f*kpt.pt.x + 0.5f;
+            kpt.pt.y = 2.f*kpt.pt.y + 0.5f;
+            kpt.size *= 2.f;
+        }
+    }
+}
+
+
+/**
+ * Describes keypoints found elsewhere, e.g. reprojected map points or optical flow tracks, without running FAST
+ * and distribution. Only the pyramid levels up to the highest octave are built and only levels with keypoints are
+ * blurred. Angles are computed for keypoints with a negative angle and written back, descriptors use the same
+ * kernels as operator() and row i belongs to keypoints[i]. Keypoints outside their level are sampled at the
+ * nearest pixel inside it (with BRIEF::BOX smoothing at least 2 pixels inside it).
+ * @param keypoints pixel coordinates of the input (as returned by operator()) with octave set
+ */
+void ORBextractor::DescribeKeypoints(cv::InputArray inputImage, std::vector<knuff::KeyPoint> &keypoints,
+                                     cv::OutputArray outputDescriptors)
+{
+    if (inputImage.empty() || keypoints.empty())
     {
         outputDescriptors.release();
+        return;
     }
-    else
+
+    cv::Mat image = inputImage.getMat();
+    message_assert("Image must be 8-bit!", image.depth() == CV_8U);
+
+    if (prevDims.x != image.cols || prevDims.y != image.rows)
     {
-        outputDescriptors.create(nkpts, 32, CV_8U);
-        BRIEFdescriptors = outputDescriptors.getMat();
+        stepsChanged = true;
+        prevDims = knuff::Point(image.cols, image.rows);
     }
 
-    resultKeypoints.clear();
-    resultKeypoints.reserve(nkpts);
+    int lastLevel = 0;
+    for (const knuff::KeyPoint &kpt : keypoints)
+    {
+        message_assert("Keypoint octave out of range!", kpt.octave >= 0 && kpt.octave < nlevels);
+        lastLevel = std::max(lastLevel, kpt.octave);
+    }
+
+    ++frameId;
+    level0Detected = false;
+    level0Blurred = false;
+    ComputeScalePyramid(image, lastLevel);
+    SetSteps();
 
-    ComputeDescriptors(allkpts, BRIEFdescriptors);
+    // box sums read BOX_RADIUS + 1 pixels beyond the BRIEF footprint, which may exceed the level border
+    const bool box = descriptorSmoothing == BRIEF::BOX;
+    const auto margin = (float)(box ? std::max(0, PyramidBlur::FOOTPRINT_RADIUS + BRIEF::BOX_RADIUS + 1 -
+                                                 EDGE_THRESHOLD) : 0);
 
-    if (distributePerLevel)
+    // level coordinates grouped by level, rows holds the input index of every grouped keypoint
+    std::vector<std::vector<knuff::KeyPoint>> allkpts(nlevels), unoriented(nlevels);
+    std::vector<std::vector<int>> indices(nlevels);
+    for (int i = 0; i < (int)keypoints.size(); ++i)
     {
-        for (int lvl = 0; lvl < nlevels; ++lvl)
+        knuff::KeyPoint kpt = keypoints[i];
+        const cv::Mat &level = imagePyramid[kpt.octave];
+        if (halfResolutionLevel0)
         {
-            float size = PATCH_SIZE * scaleFactorVec[lvl];
-            float scale = scaleFactorVec[lvl];
-            for (auto &kpt : allkpts[lvl])
-            {
-                kpt.size = size;
-                if (lvl)
-                    kpt.pt *= scale;
-            }
+            kpt.pt.x = (kpt.pt.x - 0.5f) * 0.5f;
+            kpt.pt.y = (kpt.pt.y - 0.5f) * 0.5f;
         }
+        kpt.pt *= invScaleFactorVec[kpt.octave];
+        kpt.pt.x = std::min(std::max(kpt.pt.x, margin), (float)(level.cols - 1) - margin);
+        kpt.pt.y = std::min(std::max(kpt.pt.y, margin), (float)(level.rows - 1) - margin);
+
+        if (kpt.angle < 0)
+            unoriented[kpt.octave].emplace_back(kpt);
+        allkpts[kpt.octave].emplace_back(kpt);
+        indices[kpt.octave].emplace_back(i);
     }
 
-    for (int lvl = 0; lvl < nlevels; ++lvl)
+    ComputeAngles(unoriented);
+    for (int lvl = 0; lvl <= lastLevel; ++lvl)
     {
-        resultKeypoints.insert(resultKeypoints.end(), allkpts[lvl].begin(), allkpts[lvl].end());
+        auto oriented = unoriented[lvl].begin();
+        for (size_t k = 0; k < allkpts[lvl].size(); ++k)
+        {
+            if (allkpts[lvl][k].angle >= 0)
+                continue;
+            allkpts[lvl][k].angle = oriented->angle;
+            keypoints[indices[lvl][k]].angle = (oriented++)->angle;
+        }
     }
 
-    if (saveFeatures)
+#pragma omp parallel for schedule(dynamic)
+    for (int lvl = 0; lvl <= lastLevel; ++lvl)
     {
-        fileInterface.SaveFeatures(resultKeypoints);
-        fileInterface.SaveDescriptors(BRIEFdescriptors);
+        sparseBlurLevels[lvl] = !box && !allkpts[lvl].empty() && BlurLevelSparse(lvl, (int)allkpts[lvl].size());
+        if (allkpts[lvl].empty())
+            continue;
+
+        if (box)
+        {
+            ComputeBoxSums(lvl);
+            continue;
+        }
+
+        PrepareBlurredLevel(lvl);
+        if (sparseBlurLevels[lvl])
+            continue;
+
+        PyramidBlur::Gaussian7x7(imagePyramid[lvl], blurredPyramid[lvl], blurRowBuffers[lvl]);
+        MakeBorderReflect101(blurredPyramid[lvl], EDGE_THRESHOLD);
     }
+    for (int lvl = lastLevel + 1; lvl < nlevels; ++lvl)
+        sparseBlurLevels[lvl] = false;
+    BlurSparseLevels(allkpts);
 
-    //ensure feature detection always takes 50ms
-    unsigned long maxDuration = 50000;
-    std::chrono::high_resolution_clock::time_point funcExit = std::chrono::high_resolution_clock::now();
-    auto funcDuration = std::chrono::duration_cast<std::chrono::microseconds>(funcExit-funcEntry).count();
-    //assert(funcDuration <= maxDuration);
-    //if (funcDuration < maxDuration)
-    //{
-    //    auto sleeptime = maxDuration - funcDuration;
-    //    usleep(sleeptime);
-    //}
+    std::vector<int> rows;
+    rows.reserve(keypoints.size());
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+        rows.insert(rows.end(), indices[lvl].begin(), indices[lvl].end());
+
+    outputDescriptors.create((int)keypoints.size(), GetDescriptorBytes(), CV_8U);
+    cv::Mat descriptors = outputDescriptors.getMat();
+    ComputeDescriptors(allkpts, descriptors, &rows);
 }
 
 
@@ -275,61 +594,344 @@ void ORBextractor::ComputeAngles(std::vector<std::vector<knuff::KeyPoint>> &allk
 #pragma omp parallel for
     for (int lvl = 0; lvl < nlevels; ++lvl)
     {
+        // levels without keypoints may not even be computed for this frame, see LazyFrame and DescribeKeypoints
+        if (allkpts[lvl].empty())
+            continue;
+
+        const cv::Mat &level = imagePyramid[lvl];
+        // SCALAR keeps cv::fastAtan2, so its angles do not depend on where the moments come from
+        const float tolerance = orientationMethod == Orientation::SCALAR ? 0.f : orientationTolerance;
+        const Orientation::Bins* bins = orientationBins.Count() > 0 ? &orientationBins : nullptr;
+
+        if (Orientation::PreferPrefixSums(level.size(), allkpts[lvl].size(), orientationMethod))
+        {
+            const cv::Size sumSize = Orientation::PrefixSumSize(level.size());
+            bufferAllocator.Create(momentSums[lvl], sumSize.height, sumSize.width, CV_32SC2, momentSumBlocks[lvl]);
+
+            Orientation::BuildPrefixSums(level, momentSums[lvl]);
+            Orientation::ComputeAnglesFromPrefixSums(momentSums[lvl], allkpts[lvl], tolerance, bins);
+        }
+        else if (orientationMethod == Orientation::SIMD || bins)
+            Orientation::ComputeAngles(level, allkpts[lvl], tolerance, bins);
+        else
+        {
+            for (auto &kpt : allkpts[lvl])
+                kpt.angle = IntensityCentroidAngle(&level.at<uchar>(myRound(kpt.pt.y), myRound(kpt.pt.x)),
+                                                   level.step1());
+            continue;
+        }
+
+#ifndef NDEBUG
         for (auto &kpt : allkpts[lvl])
         {
-            kpt.angle = IntensityCentroidAngle(&imagePyramid[lvl].at<uchar>(myRound(kpt.pt.y), myRound(kpt.pt.x)),
-                                               imagePyramid[lvl].step1());
+            float diff = std::abs(kpt.angle - IntensityCentroidAngle(
+                    &level.at<uchar>(myRound(kpt.pt.y), myRound(kpt.pt.x)), level.step1()));
+            // bins are chosen from the exact direction, cv::fastAtan2 deviates from it by up to 0.01 degrees
+            const float allowed = bins ? 180.f / bins->Count() + 0.01f : std::max(tolerance, 0.001f);
+            assert(std::min(diff, 360.f - diff) <= allowed);
         }
+#endif
     }
 }
 
 
-void ORBextractor::ComputeDescriptors(std::vector<std::vector<knuff::KeyPoint>> &allkpts, cv::Mat &descriptors)
+/**
+ * Keypoints of all levels are split into chunks of DESCRIPTOR_CHUNK that are described in parallel. Keypoint k
+ * of level lvl always goes to row levelStart[lvl] + k (or to rows[levelStart[lvl] + k] if given), so the output
+ * does not depend on the thread count.
+ * With orientation bins the offsets come from steeredPatterns instead of being steered per keypoint.
+ * If cache is given, descriptors are reused from it where possible and it is updated with this frame. Its
+ * signatures sample the blurred level, so it is ignored with BRIEF::BOX smoothing.
+ */
+void ORBextractor::ComputeDescriptors(std::vector<std::vector<knuff::KeyPoint>> &allkpts, cv::Mat &descriptors,
+                                      const std::vector<int>* rows, DescriptorCache* cache)
 {
-    const auto degToRadFactor = (float)(CV_PI/180.f);
-    const cv::Point* p = &pattern[0];
-
-    int current = 0;
+    const int DESCRIPTOR_CHUNK = 64;
+    const int nbins = orientationBins.Count();
+    const float binsPerDegree = (float)nbins / 360.f;
+    const bool box = descriptorSmoothing == BRIEF::BOX;
+    if (box)
+        cache = nullptr;
+    const int tests = briefPattern.tests;
+    const int footprintRadius = PyramidBlur::FOOTPRINT_RADIUS + (box ? BRIEF::BOX_RADIUS + 1 : 0);
+
+    // kernels are instantiated per descriptor length
+    auto describe = &BRIEF::Describe<256>;
+    auto describeBox = &BRIEF::DescribeBox<256>;
+    if (descriptorBits == 128)
+    {
+        describe = &BRIEF::Describe<128>;
+        describeBox = &BRIEF::DescribeBox<128>;
+    }
+    else if (descriptorBits == 512)
+    {
+        describe = &BRIEF::Describe<512>;
+        describeBox = &BRIEF::DescribeBox<512>;
+    }
 
+    std::vector<int> levelStart(nlevels + 1, 0);
     for (int lvl = 0; lvl < nlevels; ++lvl)
-    {
-        cv::Mat lvlClone = imagePyramid[lvl].clone();
-        cv::GaussianBlur(lvlClone, lvlClone, cv::Size(7, 7), 2, 2, cv::BORDER_REFLECT_101);
+        levelStart[lvl + 1] = levelStart[lvl] + (int)allkpts[lvl].size();
+    const int nkpts = levelStart[nlevels];
+    const int nchunks = (nkpts + DESCRIPTOR_CHUNK - 1) / DESCRIPTOR_CHUNK;
+
+    std::vector<uint64_t> cacheKeys(cache ? nkpts : 0);
+    std::vector<uchar> signatures(cache ? (size_t)nkpts * DescriptorCache::SIGNATURE_SIZE : 0);
+    int cacheHits = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
-        const int step = (int)lvlClone.step;
+#pragma omp parallel for schedule(static) reduction(+:cacheHits)
+    for (int chunk = 0; chunk < nchunks; ++chunk)
+    {
+        alignas(32) int steered[2*BRIEF::MAX_TESTS];
+        const int first = chunk * DESCRIPTOR_CHUNK;
+        const int last = std::min(nkpts, first + DESCRIPTOR_CHUNK);
+        int lvl = (int)(std::upper_bound(levelStart.begin(), levelStart.end(), first) - levelStart.begin()) - 1;
 
+        // box sums have the row stride of the level in elements, so offsets apply to both
+        auto centerOf = [&](int l, const knuff::KeyPoint &k)
+        {
+            const cv::Mat &smoothed = box ? boxSums[l] : blurredPyramid[l];
+            return smoothed.ptr<uchar>(myRound(k.pt.y)) + myRound(k.pt.x) * smoothed.elemSize();
+        };
 
-        int i = 0, nkpts = allkpts[lvl].size();
-        for (int k = 0; k < nkpts; ++k, ++current)
+        for (int row = first; row < last; ++row)
         {
-            const knuff::KeyPoint &kpt = allkpts[lvl][k];
-            auto descPointer = descriptors.ptr<uchar>(current);        //ptr to beginning of current descriptor
-            const uchar* pixelPointer = &lvlClone.at<uchar>(myRound(kpt.pt.y), myRound(kpt.pt.x));  //ptr to kpt in img
+            while (row >= levelStart[lvl + 1])
+                ++lvl;
+
+            if (prefetchFootprints && row + 1 < last)
+            {
+                int nextLvl = lvl;
+                while (row + 1 >= levelStart[nextLvl + 1])
+                    ++nextLvl;
+                const cv::Mat &next = box ? boxSums[nextLvl] : blurredPyramid[nextLvl];
+                BRIEF::PrefetchFootprint(centerOf(nextLvl, allkpts[nextLvl][row + 1 - levelStart[nextLvl]]),
+                                         next.step, (int)next.elemSize(), footprintRadius);
+            }
 
-            float angleRad = kpt.angle * degToRadFactor;
-            auto a = (float)cos(angleRad), b = (float)sin(angleRad);
+            const knuff::KeyPoint &kpt = allkpts[lvl][row - levelStart[lvl]];
+            const cv::Mat &smoothed = box ? boxSums[lvl] : blurredPyramid[lvl];
+            const auto step = (int)smoothed.step1();
+            const uchar* center = centerOf(lvl, kpt);
+            uchar* descriptor = descriptors.ptr<uchar>(rows ? (*rows)[row] : row);
 
-            int byte = 0, v0, v1, idx0, idx1;
-            for (i = 0; i <= 512; i+=2)
+            if (cache)
             {
-                if (i > 0 && i%16 == 0) //working byte full
+                uchar* signature = &signatures[(size_t)row * DescriptorCache::SIGNATURE_SIZE];
+                cacheKeys[row] = cache->Key(kpt);
+                DescriptorCache::Signature(center, step, signature);
+                if (cache->Lookup(cacheKeys[row], signature, descriptor))
                 {
-                    descPointer[i/16 - 1] = (uchar)byte;  //write current byte to descriptor-mat
-                    byte = 0;      //reset working byte
-                    if (i == 512)  //break out after writing very last byte, so oob indices aren't accessed
-                        break;
+                    ++cacheHits;
+                    continue;
                 }
+            }
 
-                idx0 = myRound(p[i].x*a - p[i].y*b) + myRound(p[i].x*b + p[i].y*a)*step;
-                idx1 = myRound(p[i+1].x*a - p[i+1].y*b) + myRound(p[i+1].x*b + p[i+1].y*a)*step;
+            const int* offsets = steered;
+            if (nbins > 0)
+            {
+                const int bin = (int)lrint(kpt.angle * binsPerDegree) % nbins;
+                offsets = &steeredPatterns[(lvl*nbins + bin) * 2*tests];
+            }
+            else
+                BRIEF::Steer(briefPattern, kpt.angle, step, steered, steered + tests);
 
-                v0 = pixelPointer[idx0];
-                v1 = pixelPointer[idx1];
+            if (box)
+                describeBox((const uint32_t*)center, step, offsets, offsets + tests, descriptor);
+            else
+                describe(center, offsets, offsets + tests, descriptor);
+        }
+    }
 
-                byte |= (v0 < v1) << ((i%16)/2); //write comparison bit to current byte
+    if (cache)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now() - start).count();
+        cache->Update(cacheKeys, signatures, descriptors, rows, cacheHits, (double)elapsed / 1000.);
+    }
+}
+
+/**
+ * Steers the BRIEF pattern to the center of every orientation bin for every level stride, stored as the
+ * offsets of the first points of all tests followed by those of the second points.
+ */
+void ORBextractor::BuildSteeredPatterns(const std::vector<int> &steps)
+{
+    const int nbins = orientationBins.Count();
+    const int tests = briefPattern.tests;
+    steeredPatterns.resize((size_t)nlevels * nbins * 2*tests);
+
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        for (int bin = 0; bin < nbins; ++bin)
+        {
+            int* offsets = &steeredPatterns[(lvl*nbins + bin) * 2*tests];
+            BRIEF::Steer(briefPattern, orientationBins.Angle(bin), steps[lvl], offsets, offsets + tests);
+        }
+    }
+}
+
+
+/**
+ * Blurs every level into a persistent bordered buffer with the row stride of the level, so that BRIEF offsets
+ * computed for imagePyramid also apply to blurredPyramid. The frame is reflected like the level itself.
+ * Levels chosen for sparse blurring only get their buffer here and are blurred in BlurSparseLevels,
+ * level 0 is skipped if the stripe pipeline blurred it already. With BRIEF::BOX smoothing the integral images
+ * are built instead.
+ */
+void ORBextractor::ComputeBlurredPyramid()
+{
+    if (descriptorSmoothing == BRIEF::BOX)
+    {
+        std::fill(sparseBlurLevels.begin(), sparseBlurLevels.end(), false);
+#pragma omp parallel for schedule(dynamic)
+        for (int lvl = 0; lvl < nlevels; ++lvl)
+            ComputeBoxSums(lvl);
+        return;
+    }
+
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+        sparseBlurLevels[lvl] = BlurLevelSparse(lvl, nfeaturesPerLevelVec[lvl]);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        if (lvl == 0 && level0Blurred)
+            continue;
+
+        PrepareBlurredLevel(lvl);
+        if (sparseBlurLevels[lvl])
+            continue;
+
+        PyramidBlur::Gaussian7x7(imagePyramid[lvl], blurredPyramid[lvl], blurRowBuffers[lvl]);
+        MakeBorderReflect101(blurredPyramid[lvl], EDGE_THRESHOLD);
+    }
+}
+
+
+bool ORBextractor::BlurLevelSparse(int lvl, int expectedKpts)
+{
+    return blurMode == PyramidBlur::SPARSE || (blurMode == PyramidBlur::AUTO &&
+            PyramidBlur::PreferSparse(imagePyramid[lvl].size(), expectedKpts));
+}
+
+
+void ORBextractor::PrepareBlurredLevel(int lvl)
+{
+    const cv::Mat &level = imagePyramid[lvl];
+    cv::Mat &bordered = borderedBlurredPyramid[lvl];
+    const int borderedRows = level.rows + 2*EDGE_THRESHOLD;
+    const auto stride = (int)level.step;
+
+    bufferAllocator.Create(bordered, borderedRows, stride, CV_8UC1, blurredBlocks[lvl]);
+
+    blurredPyramid[lvl] = bordered(cv::Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, level.cols, level.rows));
+}
+
+
+void ORBextractor::ComputeBoxSums(int lvl)
+{
+    const cv::Mat &level = imagePyramid[lvl];
+    cv::Mat &bordered = borderedBoxSums[lvl];
+    bufferAllocator.Create(bordered, level.rows + 2*EDGE_THRESHOLD, (int)level.step1(), CV_32SC1, boxSumBlocks[lvl]);
+
+    BRIEF::BoxSums(level, EDGE_THRESHOLD, bordered);
+    boxSums[lvl] = bordered(cv::Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, level.cols, level.rows));
+}
+
+
+/**
+ * Stripe pipeline for level 0: the input is ingested in bands of about half the L2 cache, and while a band is
+ * still cached its reflected border columns are written, FAST runs on every cell row it completes and the rows
+ * whose 7 row neighbourhood is available are blurred. Keypoints are identical to DivideAndFAST. Level 1 is
+ * still resized from the complete level 0, as cv::resize cannot be split into bands bit exactly.
+ * Has to be called after AllocateScalePyramid and SetSteps.
+ */
+void ORBextractor::ComputeLevel0Striped(const cv::Mat &image, int cellSize)
+{
+    cv::Mat &level = imagePyramid[0];
+    const int height = level.rows;
+    const FASTGrid grid = ComputeFASTGrid(0, cellSize);
+    const bool detect = levelToDisplay == -1 || levelToDisplay == 0;
+
+    int bandRows = stripeRows;
+    if (bandRows <= 0)
+    {
+        const size_t bytesPerRow = 2*level.step + image.step;
+        bandRows = (int)(L2CacheBytes() / 2 / bytesPerRow);
+    }
+    bandRows = std::max(bandRows, EDGE_THRESHOLD + 1);
+
+    level0Blurred = descriptorSmoothing == BRIEF::GAUSSIAN && !BlurLevelSparse(0, nfeaturesPerLevelVec[0]);
+    if (level0Blurred)
+        PrepareBlurredLevel(0);
+
+    level0Kpts.clear();
+    level0Kpts.reserve(nfeatures*10);
+
+    int ready = 0, nextCellRow = 0, blurredRows = 0;
+    bool topReflected = false;
+
+    while (ready < height)
+    {
+        const int end = std::min(height, ready + bandRows);
+        if (!level0Wrapped)
+            WriteLevel0Rows(image, ready, end);
+        ReflectBorderColumns(level, EDGE_THRESHOLD, ready, end);
+        ready = end;
+
+        const bool last = ready == height;
+        if (!topReflected && (last || ready > EDGE_THRESHOLD))
+        {
+            ReflectBorderRows(level, EDGE_THRESHOLD, true, last);
+            topReflected = true;
+        }
+        else if (last)
+            ReflectBorderRows(level, EDGE_THRESHOLD, false, true);
+
+        if (detect)
+        {
+            int cellRowEnd = nextCellRow;
+            while (cellRowEnd < grid.npatchesInY &&
+                   (last || grid.minimumY + (cellRowEnd + 1)*grid.patchHeight + 6 <= ready))
+                ++cellRowEnd;
+
+            FASTCellRows(0, grid, nextCellRow, cellRowEnd, level0Kpts);
+            nextCellRow = cellRowEnd;
+        }
+
+        if (level0Blurred && topReflected)
+        {
+            const int blurEnd = last ? height : ready - 3;
+            if (blurEnd > blurredRows)
+            {
+                cv::Mat blurredBand = blurredPyramid[0].rowRange(blurredRows, blurEnd);
+                PyramidBlur::Gaussian7x7(level.rowRange(blurredRows, blurEnd), blurredBand, blurRowBuffers[0]);
+                blurredRows = blurEnd;
             }
         }
     }
+
+    if (level0Blurred)
+        MakeBorderReflect101(blurredPyramid[0], EDGE_THRESHOLD);
+
+    level0Detected = detect;
+}
+
+
+void ORBextractor::BlurSparseLevels(std::vector<std::vector<knuff::KeyPoint>> &allkpts)
+{
+#pragma omp parallel for schedule(dynamic)
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        if (!sparseBlurLevels[lvl] || allkpts[lvl].empty())
+            continue;
+
+        PyramidBlur::Gaussian7x7Sparse(imagePyramid[lvl], blurredPyramid[lvl], allkpts[lvl], blurTileMasks[lvl],
+                                       blurRowBuffers[lvl]);
+        MakeBorderReflect101(blurredPyramid[lvl], EDGE_THRESHOLD);
+    }
 }
 
 
@@ -412,194 +1014,455 @@ void ORBextractor::DivideAndFAST(std::vector<std::vector<knuff::KeyPoint>> &allk
 #pragma omp parallel for
         for (int lvl = minLvl; lvl < maxLvl; ++lvl)
         {
+            const FASTGrid grid = ComputeFASTGrid(lvl, cellSize);
+            const int maximumX = grid.maximumX, maximumY = grid.maximumY;
+
             std::vector<knuff::KeyPoint> levelKpts;
-            levelKpts.clear();
-            levelKpts.reserve(nfeatures*10);
+            if (lvl == 0 && level0Detected)
+            {
+                levelKpts.swap(level0Kpts);
+            }
+            else
+            {
+                levelKpts.reserve(nfeatures*10);
+                FASTCellRows(lvl, grid, 0, grid.npatchesInY, levelKpts);
+            }
 
-            const int maximumX = imagePyramid[lvl].cols - EDGE_THRESHOLD + 3;
-            const int maximumY = imagePyramid[lvl].rows - EDGE_THRESHOLD + 3;
-            const float width = maximumX - minimumX;
-            const float height = maximumY - minimumY;
+            allkpts[lvl].reserve(nfeatures);
 
-            const int npatchesInX = width / cellSize;
-            const int npatchesInY = height / cellSize;
-            const int patchWidth = ceil(width / npatchesInX);
-            const int patchHeight = ceil(height / npatchesInY);
+            if (distributePerLevel)
+            {
+                using clk = std::chrono::high_resolution_clock;
+                clk::time_point t0 = clk::now();
+                Distribution::DistributeKeypoints(levelKpts, minimumX, maximumX, minimumY, maximumY,
+                                                  nfeaturesPerLevelVec[lvl], mode, softSSCThreshold);
+                clk::time_point t1 = clk::now();
+                long duration = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+                distributionDuration += duration;
+            }
 
-#if THREADEDPATCHES
-            int nCells = npatchesInX * npatchesInY;
-            int offset[CIRCLE_SIZE];
-            for (int i = 0; i < CIRCLE_SIZE; ++i)
+            allkpts[lvl] = levelKpts;
+
+
+
+            for (auto &kpt : allkpts[lvl])
             {
-                offset[i] = pixelOffset[lvl*CIRCLE_SIZE + i];
+                kpt.pt.y += minimumY;
+                kpt.pt.x += minimumX;
+                kpt.octave = lvl;
             }
-            std::vector<std::promise<bool>> promises(nCells);
-            int curCell = 0;
+        }
+        timeVector.emplace_back(distributionDuration);
+    }
+}
 
-            std::vector<std::vector<knuff::KeyPoint>> cellkptvecs;
+/**
+ * Cell layout of DivideAndFAST for one level: FAST runs on overlapping cells of about cellSize inside
+ * [minimum, maximum), keypoints are relative to (minimumX, minimumY).
+ */
+ORBextractor::FASTGrid ORBextractor::ComputeFASTGrid(int lvl, int cellSize)
+{
+    FASTGrid grid;
+    grid.minimumX = EDGE_THRESHOLD - 3;
+    grid.minimumY = grid.minimumX;
+    grid.maximumX = imagePyramid[lvl].cols - EDGE_THRESHOLD + 3;
+    grid.maximumY = imagePyramid[lvl].rows - EDGE_THRESHOLD + 3;
+
+    const float width = grid.maximumX - grid.minimumX;
+    const float height = grid.maximumY - grid.minimumY;
+
+    grid.npatchesInX = width / cellSize;
+    grid.npatchesInY = height / cellSize;
+    grid.patchWidth = ceil(width / grid.npatchesInX);
+    grid.patchHeight = ceil(height / grid.npatchesInY);
+    return grid;
+}
+
+/**
+ * Runs FAST on the cell rows [firstRow, lastRow) of the grid and appends the results to levelKpts.
+ * Cell row py reads level rows [minimumY + py*patchHeight, min(minimumY + (py+1)*patchHeight + 6, maximumY)).
+ */
+void ORBextractor::FASTCellRows(int lvl, const FASTGrid &grid, int firstRow, int lastRow,
+                                std::vector<knuff::KeyPoint> &levelKpts)
+{
+    const int minimumX = grid.minimumX, minimumY = grid.minimumY;
+    const int maximumX = grid.maximumX, maximumY = grid.maximumY;
+    const int npatchesInX = grid.npatchesInX;
+    const int patchWidth = grid.patchWidth, patchHeight = grid.patchHeight;
+
+#if THREADEDPATCHES
+    int nCells = npatchesInX * (lastRow - firstRow);
+    int offset[CIRCLE_SIZE];
+    for (int i = 0; i < CIRCLE_SIZE; ++i)
+    {
+        offset[i] = pixelOffset[lvl*CIRCLE_SIZE + i];
+    }
+    std::vector<std::promise<bool>> promises(nCells);
+    int curCell = 0;
+
+    std::vector<std::vector<knuff::KeyPoint>> cellkptvecs;
 #endif
 
-            for (int py = 0; py < npatchesInY; ++py)
-            {
-                float startY = minimumY + py * patchHeight;
-                float endY = startY + patchHeight + 6;
+    for (int py = firstRow; py < lastRow; ++py)
+    {
+        float startY = minimumY + py * patchHeight;
+        float endY = startY + patchHeight + 6;
 
-                if (startY >= maximumY-3)
-                    continue;
+        if (startY >= maximumY-3)
+            continue;
 
-                if (endY > maximumY)
-                    endY = maximumY;
+        if (endY > maximumY)
+            endY = maximumY;
 
-                for (int px = 0; px < npatchesInX; ++px)
-                {
-                    float startX = minimumX + px * patchWidth;
-                    float endX = startX + patchWidth + 6;
+        for (int px = 0; px < npatchesInX; ++px)
+        {
+            float startX = minimumX + px * patchWidth;
+            float endX = startX + patchWidth + 6;
 
-                    if (startX >= maximumX-6)
-                        continue;
+            if (startX >= maximumX-6)
+                continue;
 
-                    if (endX > maximumX)
-                        endX = maximumX;
+            if (endX > maximumX)
+                endX = maximumX;
 
-                    //std::chrono::high_resolution_clock::time_point FASTEntry =
-                    //        std::chrono::high_resolution_clock::now();
+            //std::chrono::high_resolution_clock::time_point FASTEntry =
+            //        std::chrono::high_resolution_clock::now();
 
 #if MYFAST
 #if THREADEDPATCHES
-                    fast.workerPool.PushImg(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                            cellkptvecs[curCell], offset, iniThFAST, lvl, &promises[curCell]);
-                    ++curCell;
+            fast.workerPool.PushImg(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                    cellkptvecs[curCell], offset, iniThFAST, lvl, &promises[curCell]);
+            ++curCell;
 
 #else
-                    std::vector<knuff::KeyPoint> patchKpts;
-                    fast.FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                              patchKpts, iniThFAST, lvl);
-                    if (patchKpts.empty())
-                    {
-                        fast.FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                                  patchKpts, minThFAST, lvl);
-                    }
+            std::vector<knuff::KeyPoint> patchKpts;
+            fast.FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                      patchKpts, iniThFAST, lvl);
+            if (patchKpts.empty())
+            {
+                fast.FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                          patchKpts, minThFAST, lvl);
+            }
 #endif
 #elif TESTFAST
-                    std::vector<knuff::KeyPoint> patchKpts;
-                    blorp::FAST_t<16>(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                                      patchKpts, iniThFAST, true);
-                    if (patchKpts.empty())
-                        blorp::FAST_t<16>(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                                          patchKpts, minThFAST, true);
+            std::vector<knuff::KeyPoint> patchKpts;
+            blorp::FAST_t<16>(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                              patchKpts, iniThFAST, true);
+            if (patchKpts.empty())
+                blorp::FAST_t<16>(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                                  patchKpts, minThFAST, true);
 
 #else
-                    std::vector<knuff::KeyPoint> patchKpts;
-                    cv::FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                            patchKpts, iniThFAST, true, cv::FastFeatureDetector::TYPE_9_16);
-                    if (patchKpts.empty())
-                    {
-                        cv::FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
-                            patchKpts, minThFAST, true, cv::FastFeatureDetector::TYPE_9_16);
-                    }
+            std::vector<knuff::KeyPoint> patchKpts;
+            cv::FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                    patchKpts, iniThFAST, true, cv::FastFeatureDetector::TYPE_9_16);
+            if (patchKpts.empty())
+            {
+                cv::FAST(imagePyramid[lvl].rowRange(startY, endY).colRange(startX, endX),
+                    patchKpts, minThFAST, true, cv::FastFeatureDetector::TYPE_9_16);
+            }
 #endif
 #if !THREADEDPATCHES
-                    if(patchKpts.empty())
-                        continue;
-
-                    for (auto &kpt : patchKpts)
-                    {
-                        kpt.pt.y += py * patchHeight;
-                        kpt.pt.x += px * patchWidth;
-                        levelKpts.emplace_back(kpt);
-                    }
-#endif
-                }
-            }
-#if THREADEDPATCHES
-            for (int i = 0; i < nCells; ++i)
+            if(patchKpts.empty())
+                continue;
+
+            for (auto &kpt : patchKpts)
             {
-                promises[i].get_future().wait();
-                for (auto &kpt : cellkptvecs[i])
-                {
-                    kpt.pt.x += ((i%npatchesInX) * patchWidth);
-                    kpt.pt.y += ((int)(i/npatchesInX) * patchHeight);
-                    levelKpts.emplace_back(kpt);
-                }
+                kpt.pt.y += py * patchHeight;
+                kpt.pt.x += px * patchWidth;
+                levelKpts.emplace_back(kpt);
             }
 #endif
+        }
+    }
+#if THREADEDPATCHES
+    for (int i = 0; i < nCells; ++i)
+    {
+        promises[i].get_future().wait();
+        for (auto &kpt : cellkptvecs[i])
+        {
+            kpt.pt.x += ((i%npatchesInX) * patchWidth);
+            kpt.pt.y += ((firstRow + (int)(i/npatchesInX)) * patchHeight);
+            levelKpts.emplace_back(kpt);
+        }
+    }
+#endif
+}
 
-            allkpts[lvl].reserve(nfeatures);
+/** @param lastLevel highest level to compute, all levels if negative */
+void ORBextractor::ComputeScalePyramid(cv::Mat &image, int lastLevel)
+{
+    AllocateScalePyramid(image);
 
-            if (distributePerLevel)
-            {
-                using clk = std::chrono::high_resolution_clock;
-                clk::time_point t0 = clk::now();
-                Distribution::DistributeKeypoints(levelKpts, minimumX, maximumX, minimumY, maximumY,
-                                                  nfeaturesPerLevelVec[lvl], mode, softSSCThreshold);
-                clk::time_point t1 = clk::now();
-                long duration = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
-                distributionDuration += duration;
-            }
+    if (!level0Wrapped)
+        WriteLevel0Rows(image, 0, imagePyramid[0].rows);
+    MakeBorderReflect101(imagePyramid[0], EDGE_THRESHOLD);
 
-            allkpts[lvl] = levelKpts;
+    ComputeUpperLevels(lastLevel);
+}
+
+/**
+ * Resolves the input format and points imagePyramid at the interiors of the (re)allocated bordered levels.
+ * Level 0 wraps the input instead if padded input wrapping is enabled and possible, see level0Wrapped.
+ */
+void ORBextractor::AllocateScalePyramid(cv::Mat &image)
+{
+    const int doubleEdge = EDGE_THRESHOLD * 2;
 
+    level0Format = ImageIngest::ResolveFormat(inputFormat, image.channels());
+    halfResolutionLevel0 = bayerGreenHalfResolution && ImageIngest::IsBayer(level0Format);
+    const cv::Size baseSize = ImageIngest::OutputSize(image, level0Format, halfResolutionLevel0);
+    level0Wrapped = false;
+    std::vector<cv::Size> levelSizes(nlevels);
 
+    for (int lvl = 0; lvl < nlevels; ++ lvl)
+    {
+        int width = (int)myRound(baseSize.width * invScaleFactorVec[lvl]); // 1.f / getScale(lvl));
+        int height = (int)myRound(baseSize.height * invScaleFactorVec[lvl]); // 1.f / getScale(lvl));
 
-            for (auto &kpt : allkpts[lvl])
+        if (lvl == 0 && wrapPaddedInput && !undistortInput && level0Format == ImageIngest::GRAY)
+        {
+            cv::Size wholeSize;
+            cv::Point offset;
+            image.locateROI(wholeSize, offset);
+            if (offset.x >= EDGE_THRESHOLD && offset.y >= EDGE_THRESHOLD &&
+                wholeSize.width - offset.x - image.cols >= EDGE_THRESHOLD &&
+                wholeSize.height - offset.y - image.rows >= EDGE_THRESHOLD)
             {
-                kpt.pt.y += minimumY;
-                kpt.pt.x += minimumX;
-                kpt.octave = lvl;
+                imagePyramid[0] = image;
+                level0Wrapped = true;
+                continue;
             }
         }
-        timeVector.emplace_back(distributionDuration);
+
+        const cv::Mat &borderedImg = borderedPyramid[lvl];
+        if (borderedImg.rows != height + doubleEdge || borderedImg.cols != width + doubleEdge)
+            stepsChanged = true;
+
+        levelSizes[lvl] = cv::Size(width, height);
+    }
+
+    // same static schedule as the FAST loop in DivideAndFAST, so first touch happens on the detecting thread
+#pragma omp parallel for if (bufferAllocator.GetFirstTouch())
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        if (lvl == 0 && level0Wrapped)
+            continue;
+
+        const cv::Size &sz = levelSizes[lvl];
+        bufferAllocator.Create(borderedPyramid[lvl], sz.height + doubleEdge, sz.width + doubleEdge, CV_8UC1,
+                               pyramidBlocks[lvl]);
+        imagePyramid[lvl] = borderedPyramid[lvl](cv::Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
     }
 }
 
-void ORBextractor::ComputeScalePyramid(cv::Mat &image)
+/** Converts (or undistorts) rows [firstRow, lastRow) of the input into the level 0 interior */
+void ORBextractor::WriteLevel0Rows(const cv::Mat &image, int firstRow, int lastRow)
 {
-    for (int lvl = 0; lvl < nlevels; ++ lvl)
-    {
-        int width = (int)myRound(image.cols * invScaleFactorVec[lvl]); // 1.f / getScale(lvl));
-        int height = (int)myRound(image.rows * invScaleFactorVec[lvl]); // 1.f / getScale(lvl));
+    if (undistortInput)
+        UndistortLevel0(image, level0Format, firstRow, lastRow);
+    else
+        ImageIngest::ToGray(image, imagePyramid[0], level0Format, halfResolutionLevel0, firstRow, lastRow);
+}
 
-        int doubleEdge = EDGE_THRESHOLD * 2;
-        int borderedWidth = width + doubleEdge;
-        int borderedHeight = height + doubleEdge;
+/** Fills levels 1..lastLevel (nlevels-1 if negative) from the complete, bordered level 0 */
+void ORBextractor::ComputeUpperLevels(int lastLevel)
+{
+    int builtOctaves = 0;
+    if (lastLevel < 0)
+        lastLevel = nlevels - 1;
+
+    for (int lvl = 1; lvl <= lastLevel; ++lvl)
+    {
+        // the interior is written in place, only the reflected frame around it is synthesised afterwards
+        if (octaveAnchoredPyramid)
+            ResizeFromOctaveAnchor(lvl, builtOctaves);
+        else
+            cv::resize(imagePyramid[lvl-1], imagePyramid[lvl], imagePyramid[lvl].size(), 0, 0, CV_INTER_LINEAR);
 
-        //Size sz(width, height);
-        //Size borderedSize(borderedWidth, borderedHeight);
+        MakeBorderReflect101(imagePyramid[lvl], EDGE_THRESHOLD);
+    }
+}
 
-        cv::Mat borderedImg(borderedHeight, borderedWidth, image.type());
-        cv::Range rowRange(EDGE_THRESHOLD, height + EDGE_THRESHOLD);
-        cv::Range colRange(EDGE_THRESHOLD, width + EDGE_THRESHOLD);
+/**
+ * Interpolates level lvl from its predecessor if both lie in the same octave floor(log2(scale)), otherwise from the
+ * anchor of its octave, decimating the anchors it depends on first. Either way the ratio is at most scaleFactor,
+ * and bilinear passes only compound within an octave.
+ * A level whose size equals a new anchor is decimated into directly and becomes that anchor.
+ * @param builtOctaves number of anchors above level 0 that are valid for the current frame
+ */
+void ORBextractor::ResizeFromOctaveAnchor(int lvl, int &builtOctaves)
+{
+    auto octaveOf = [this](int l){return (int)std::floor(std::log2(scaleFactorVec[l]) + 1e-4);};
+    const int octave = octaveOf(lvl);
+    cv::Mat &level = imagePyramid[lvl];
 
-        //imagePyramid[lvl] = borderedImg(cv::Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, width, height));
-        imagePyramid[lvl] = borderedImg(rowRange, colRange);
+    if ((int)octaveAnchors.size() <= octave)
+    {
+        octaveAnchors.resize(octave + 1);
+        octaveAnchorBlocks.resize(octave + 1);
+    }
+    octaveAnchors[0] = imagePyramid[0];
 
+    while (builtOctaves < octave)
+    {
+        const cv::Mat &finer = octaveAnchors[builtOctaves++];
+        cv::Size half(finer.cols/2, finer.rows/2);
 
-        if (lvl)
+        if (builtOctaves == octave && half == level.size())
         {
-            cv::resize(imagePyramid[lvl-1], imagePyramid[lvl], cv::Size(width, height), 0, 0, CV_INTER_LINEAR);
+            Decimator::Box2x(finer, level);
+            octaveAnchors[octave] = level;
+            return;
+        }
+
+        bufferAllocator.Create(octaveAnchors[builtOctaves], half.height, half.width, CV_8UC1,
+                               octaveAnchorBlocks[builtOctaves]);
+        Decimator::Box2x(finer, octaveAnchors[builtOctaves]);
+    }
 
-            cv::copyMakeBorder(imagePyramid[lvl], borderedImg, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                               EDGE_THRESHOLD, cv::BORDER_REFLECT_101+cv::BORDER_ISOLATED);
+    const cv::Mat &source = octaveOf(lvl-1) == octave ? imagePyramid[lvl-1] : octaveAnchors[octave];
+    cv::resize(source, level, level.size(), 0, 0, CV_INTER_LINEAR);
+}
+
+
+void ORBextractor::SetCameraCalibration(const cv::Mat &K, const cv::Mat &distCoeffs, const cv::Mat &R,
+                                        const cv::Mat &P)
+{
+    assert(K.rows == 3 && K.cols == 3);
+    assert(R.empty() || (R.rows == 3 && R.cols == 3));
+    assert(P.empty() || (P.rows == 3 && P.cols >= 3));
+
+    cameraMatrix = K.clone();
+    distortionCoeffs = distCoeffs.clone();
+    rectificationRotation = R.clone();
+    newCameraMatrix = P.empty() ? cv::Mat() : P.colRange(0, 3).clone();
+    undistortLUT.srcStep = -1;
+    undistortInput = true;
+}
+
+/**
+ * Remaps rows [firstRow, lastRow) of the level 0 interior from the input. Gray input is sampled directly, other
+ * formats are converted into ingestBuffer first. For half resolution green input the calibration is scaled to
+ * the green grid.
+ */
+void ORBextractor::UndistortLevel0(const cv::Mat &image, ImageIngest::InputFormat format, int firstRow, int lastRow)
+{
+    cv::Mat gray = image;
+    if (format != ImageIngest::GRAY)
+    {
+        // remapped rows may sample anywhere in the source, so it is converted completely with the first rows
+        if (firstRow == 0)
+        {
+            bufferAllocator.Create(ingestBuffer, imagePyramid[0].rows, imagePyramid[0].cols, CV_8UC1, ingestBlock);
+            ImageIngest::ToGray(image, ingestBuffer, format, halfResolutionLevel0);
         }
-        else
+        gray = ingestBuffer;
+    }
+
+    if (firstRow == 0 && (!undistortLUT.Matches(gray.size(), (int)gray.step) ||
+                          undistortLUTHalfResolution != halfResolutionLevel0))
+    {
+        cv::Mat K = cameraMatrix;
+        cv::Mat P = newCameraMatrix;
+        if (halfResolutionLevel0)
         {
-            cv::copyMakeBorder(image, borderedImg, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                               cv::BORDER_REFLECT_101);
+            // green pixel j covers full resolution pixels 2j and 2j+1, its centre is at 2j + 0.5
+            auto toHalf = [](const cv::Mat &m)
+            {
+                cv::Mat half;
+                m.convertTo(half, CV_64F);
+                for (int r = 0; r < 2; ++r)
+                    for (int c = 0; c < 3; ++c)
+                        half.at<double>(r, c) = 0.5*half.at<double>(r, c) - 0.25*half.at<double>(2, c);
+                return half;
+            };
+            K = toHalf(cameraMatrix);
+            if (!P.empty())
+                P = toHalf(newCameraMatrix);
         }
+        ImageIngest::BuildUndistortionLUT(K, distortionCoeffs, rectificationRotation, P, gray.size(),
+                                          (int)gray.step, undistortLUT);
+        undistortLUTHalfResolution = halfResolutionLevel0;
     }
+
+    ImageIngest::Remap(gray, imagePyramid[0], undistortLUT, firstRow, lastRow);
 }
 
-void ORBextractor::SetSteps()
+/**
+ * Writes a BORDER_REFLECT_101 frame of width border around level, which has to be a ROI with at least
+ * border pixels of allocated memory on each side. The interior is not touched.
+ */
+void ORBextractor::MakeBorderReflect101(cv::Mat &level, int border)
+{
+    ReflectBorderColumns(level, border, 0, level.rows);
+    ReflectBorderRows(level, border, true, true);
+}
+
+/** Writes the left and right part of the reflected frame for rows [firstRow, lastRow) */
+void ORBextractor::ReflectBorderColumns(cv::Mat &level, int border, int firstRow, int lastRow)
 {
-    if (stepsChanged)
+    const int width = level.cols;
+    const auto step = (ptrdiff_t)level.step1();
+    uchar* origin = level.data;
+
+    assert(border <= EDGE_THRESHOLD);
+    int leftIdx[EDGE_THRESHOLD], rightIdx[EDGE_THRESHOLD];
+    for (int i = 0; i < border; ++i)
     {
-        std::vector<int> steps(nlevels);
-        for (int lvl = 0; lvl < nlevels; ++lvl)
+        leftIdx[i] = cv::borderInterpolate(i - border, width, cv::BORDER_REFLECT_101);
+        rightIdx[i] = cv::borderInterpolate(width + i, width, cv::BORDER_REFLECT_101);
+    }
+
+    for (int y = firstRow; y < lastRow; ++y)
+    {
+        uchar* row = origin + y*step;
+        for (int i = 0; i < border; ++i)
         {
-            steps[lvl] = (int)imagePyramid[lvl].step1();
+            row[i - border] = row[leftIdx[i]];
+            row[width + i] = row[rightIdx[i]];
         }
+    }
+}
+
+/**
+ * Writes the top and/or bottom strip of the reflected frame. They are copied as whole bordered rows, corners
+ * included, so the columns of the source rows have to be reflected already.
+ */
+void ORBextractor::ReflectBorderRows(cv::Mat &level, int border, bool top, bool bottom)
+{
+    const int height = level.rows;
+    const int borderedWidth = level.cols + 2*border;
+    const auto step = (ptrdiff_t)level.step1();
+    uchar* origin = level.data;
+
+    for (int i = 0; i < border; ++i)
+    {
+        int srcTop = cv::borderInterpolate(i - border, height, cv::BORDER_REFLECT_101);
+        int srcBottom = cv::borderInterpolate(height + i, height, cv::BORDER_REFLECT_101);
+        if (top)
+            memcpy(origin + (i - border)*step - border, origin + srcTop*step - border, borderedWidth);
+        if (bottom)
+            memcpy(origin + (height + i)*step - border, origin + srcBottom*step - border, borderedWidth);
+    }
+}
+
+void ORBextractor::SetSteps()
+{
+    std::vector<int> steps(nlevels);
+    for (int lvl = 0; lvl < nlevels; ++lvl)
+    {
+        steps[lvl] = (int)imagePyramid[lvl].step1();
+    }
+
+    if (stepsChanged || steps != levelSteps)
+    {
         fast.SetLevels(nlevels);
         fast.SetStepVector(steps);
+        levelSteps = steps;
+
+        if (orientationBins.Count() > 0)
+            BuildSteeredPatterns(steps);
 
         stepsChanged = false;
     }
@@ -612,6 +1475,19 @@ void ORBextractor::SetnLevels(int n)
     scaleFactorVec.resize(nlevels);
     invScaleFactorVec.resize(nlevels);
     imagePyramid.resize(nlevels);
+    borderedPyramid.resize(nlevels);
+    blurredPyramid.resize(nlevels);
+    borderedBlurredPyramid.resize(nlevels);
+    pyramidBlocks.resize(nlevels);
+    blurredBlocks.resize(nlevels);
+    boxSums.resize(nlevels);
+    borderedBoxSums.resize(nlevels);
+    boxSumBlocks.resize(nlevels);
+    momentSums.resize(nlevels);
+    momentSumBlocks.resize(nlevels);
+    blurRowBuffers.resize(nlevels);
+    blurTileMasks.resize(nlevels);
+    sparseBlurLevels.resize(nlevels);
     nfeaturesPerLevelVec.resize(nlevels);
     levelSigma2Vec.resize(nlevels);
     invLevelSigma2Vec.resize(nlevels);
@@ -0,0 +1,359 @@
+#include "include/Orientation.h"
+#include "include/ORBconstants.h"
+#include <cassert>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using ORB_SLAM2::PATCH_SIZE;
+using ORB_SLAM2::CIRCULAR_ROWS;
+
+const int HALF_PATCH = PATCH_SIZE / 2;
+
+// odd minimax polynomials for atan on [0, 1] in degrees, lowest order first; degree 7 is cv::fastAtan2's
+const float RAD_TO_DEG = (float)(180 / CV_PI);
+const float ATAN_P3[2] = {0.9725099279641104f*RAD_TO_DEG, -0.19226407080003946f*RAD_TO_DEG};
+const float ATAN_P5[3] = {0.9949417763180572f*RAD_TO_DEG, -0.2870339128302408f*RAD_TO_DEG,
+                          0.0780182598694985f*RAD_TO_DEG};
+const float ATAN_P7[4] = {0.9997878412794807f*RAD_TO_DEG, -0.3258083974640975f*RAD_TO_DEG,
+                          0.1555786518463281f*RAD_TO_DEG, -0.04432655554792128f*RAD_TO_DEG};
+
+const float ATAN_P3_ERROR = 0.29f;
+const float ATAN_P5_ERROR = 0.04f;
+
+// nanoseconds, see PreferPrefixSums; the prefix sum lookups of 31 rows mostly miss L1, hence the keypoint cost
+const double PREFIX_SUM_PIXEL_COST = 3.;
+const double PREFIX_SUM_KPT_COST = 300.;
+const double KPT_COST[2] = {650., 110.};
+
+#ifdef __AVX2__
+struct RowMasks
+{
+    // byte i of row y covers x = i - HALF_PATCH
+    alignas(32) uchar masks[HALF_PATCH + 1][32];
+    alignas(32) short xWeights[32];
+
+    RowMasks()
+    {
+        for (int y = 0; y <= HALF_PATCH; ++y)
+            for (int i = 0; i < 32; ++i)
+                masks[y][i] = std::abs(i - HALF_PATCH) <= CIRCULAR_ROWS[y] ? 0xFF : 0;
+        for (int i = 0; i < 32; ++i)
+            xWeights[i] = (short)(i - HALF_PATCH);
+    }
+};
+
+static const RowMasks ROW_MASKS;
+#endif
+
+
+void Orientation::Moments(const uchar* center, int step, int &m10, int &m01)
+{
+#ifdef __AVX2__
+    const __m256i xwLo = _mm256_load_si256((const __m256i*)ROW_MASKS.xWeights);
+    const __m256i xwHi = _mm256_load_si256((const __m256i*)(ROW_MASKS.xWeights + 16));
+    const uchar* start = center - HALF_PATCH;
+
+    __m256i mid = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)start),
+                                   _mm256_load_si256((const __m256i*)ROW_MASKS.masks[0]));
+    __m256i acc10 = _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(mid)), xwLo),
+            _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(mid, 1)), xwHi));
+    __m256i acc01 = _mm256_setzero_si256();
+
+    for (int y = 1; y <= HALF_PATCH; ++y)
+    {
+        const __m256i mask = _mm256_load_si256((const __m256i*)ROW_MASKS.masks[y]);
+        __m256i up = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(start + y*step)), mask);
+        __m256i down = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(start - y*step)), mask);
+
+        __m256i upLo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(up));
+        __m256i upHi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(up, 1));
+        __m256i downLo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(down));
+        __m256i downHi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(down, 1));
+
+        // x * (up + down) <= 15 * 510 and y * 2 * 255 fit into 16 bit, madd widens to 32 bit
+        acc10 = _mm256_add_epi32(acc10, _mm256_madd_epi16(_mm256_add_epi16(upLo, downLo), xwLo));
+        acc10 = _mm256_add_epi32(acc10, _mm256_madd_epi16(_mm256_add_epi16(upHi, downHi), xwHi));
+        __m256i diff = _mm256_add_epi16(_mm256_sub_epi16(upLo, downLo), _mm256_sub_epi16(upHi, downHi));
+        acc01 = _mm256_add_epi32(acc01, _mm256_madd_epi16(diff, _mm256_set1_epi16((short)y)));
+    }
+
+    // horizontal sums of both accumulators at once
+    __m256i sums = _mm256_hadd_epi32(acc10, acc01);
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    s = _mm_hadd_epi32(s, s);
+    m10 = _mm_cvtsi128_si32(s);
+    m01 = _mm_extract_epi32(s, 1);
+#else
+    m10 = 0;
+    m01 = 0;
+    for (int x = -HALF_PATCH; x <= HALF_PATCH; ++x)
+        m10 += x * center[x];
+
+    for (int y = 1; y <= HALF_PATCH; ++y)
+    {
+        const int cols = CIRCULAR_ROWS[y];
+        int sumY = 0;
+        for (int x = -cols; x <= cols; ++x)
+        {
+            int uptown = center[x + y*step];
+            int downtown = center[x - y*step];
+            sumY += uptown - downtown;
+            m10 += x * (uptown + downtown);
+        }
+        m01 += y * sumY;
+    }
+#endif
+}
+
+
+void Orientation::ComputeAngles(const cv::Mat &level, std::vector<knuff::KeyPoint> &kpts, float tolerance,
+                                const Bins* bins)
+{
+    assert(level.type() == CV_8UC1);
+
+    const auto step = (int)level.step;
+    const int n = (int)kpts.size();
+
+    float m10[8], m01[8], angles[8];
+    for (int first = 0; first < n; first += 8)
+    {
+        const int batch = std::min(8, n - first);
+        for (int i = 0; i < batch; ++i)
+        {
+            const knuff::KeyPoint &kpt = kpts[first + i];
+            int x, y;
+            Moments(level.ptr<uchar>((int)lrint(kpt.pt.y)) + lrint(kpt.pt.x), step, x, y);
+            m10[i] = (float)x;
+            m01[i] = (float)y;
+        }
+
+        AnglesFromMoments(m01, m10, angles, batch, tolerance, bins);
+
+        for (int i = 0; i < batch; ++i)
+            kpts[first + i].angle = angles[i];
+    }
+}
+
+
+cv::Size Orientation::PrefixSumSize(cv::Size levelSize)
+{
+    return cv::Size(levelSize.width + 2*(HALF_PATCH + 1) + 1, levelSize.height + 2*HALF_PATCH);
+}
+
+
+void Orientation::BuildPrefixSums(const cv::Mat &level, cv::Mat &sums)
+{
+    assert(level.type() == CV_8UC1);
+    assert(sums.size() == PrefixSumSize(level.size()) && sums.type() == CV_32SC2);
+
+    const int width = sums.cols - 1;
+    for (int r = 0; r < sums.rows; ++r)
+    {
+        const uchar* src = level.ptr<uchar>(r - HALF_PATCH) - (HALF_PATCH + 1);
+        auto row = sums.ptr<uint32_t>(r);
+
+        uint32_t accI = 0, accXI = 0;
+        row[0] = 0;
+        row[1] = 0;
+        for (int x = 0; x < width; ++x)
+        {
+            accI += src[x];
+            accXI += (uint32_t)x * src[x];
+            row[2*x + 2] = accI;
+            row[2*x + 3] = accXI;
+        }
+    }
+}
+
+
+void Orientation::ComputeAnglesFromPrefixSums(const cv::Mat &sums, std::vector<knuff::KeyPoint> &kpts,
+                                              float tolerance, const Bins* bins)
+{
+    const int n = (int)kpts.size();
+    const auto step = (int)sums.step1();
+
+    // keypoints are visited in row order (counting sort), so neighbouring keypoints reuse cached prefix rows
+    std::vector<int> rowStart(sums.rows + 1, 0);
+    std::vector<int> order(n);
+    for (const knuff::KeyPoint &kpt : kpts)
+        ++rowStart[lrint(kpt.pt.y) + HALF_PATCH + 1];
+    for (int r = 0; r < sums.rows; ++r)
+        rowStart[r + 1] += rowStart[r];
+    for (int i = 0; i < n; ++i)
+        order[rowStart[lrint(kpts[i].pt.y) + HALF_PATCH]++] = i;
+
+    float m10[8], m01[8], angles[8];
+    for (int first = 0; first < n; first += 8)
+    {
+        const int batch = std::min(8, n - first);
+        for (int i = 0; i < batch; ++i)
+        {
+            const knuff::KeyPoint &kpt = kpts[order[first + i]];
+            // framed coordinates of the center
+            const int cx = (int)lrint(kpt.pt.x) + HALF_PATCH + 1;
+            const int cy = (int)lrint(kpt.pt.y) + HALF_PATCH;
+            const auto center = sums.ptr<uint32_t>(cy);
+
+            int x = 0, y = 0;
+            for (int dy = -HALF_PATCH; dy <= HALF_PATCH; ++dy)
+            {
+                const int w = CIRCULAR_ROWS[std::abs(dy)];
+                const uint32_t* right = center + dy*step + 2*(cx + w + 1);
+                const uint32_t* left = center + dy*step + 2*(cx - w);
+                const auto s0 = (int)(right[0] - left[0]);
+                const auto s1 = (int)(right[1] - left[1]);
+                x += s1 - cx*s0;
+                y += dy*s0;
+            }
+            m10[i] = (float)x;
+            m01[i] = (float)y;
+        }
+
+        AnglesFromMoments(m01, m10, angles, batch, tolerance, bins);
+
+        for (int i = 0; i < batch; ++i)
+            kpts[order[first + i]].angle = angles[i];
+    }
+}
+
+
+bool Orientation::PreferPrefixSums(cv::Size levelSize, size_t nkpts, Method method)
+{
+    if (nkpts == 0)
+        return false;
+    if (method == PREFIX_SUM)
+        return true;
+
+    const cv::Size framed = PrefixSumSize(levelSize);
+    const double buildCost = PREFIX_SUM_PIXEL_COST * framed.area();
+    return buildCost + PREFIX_SUM_KPT_COST * nkpts < KPT_COST[method] * nkpts;
+}
+
+
+void Orientation::AnglesFromMoments(const float* m01, const float* m10, float* angles, int n, float tolerance,
+                                    const Bins* bins)
+{
+    if (bins)
+    {
+        for (int i = 0; i < n; ++i)
+            angles[i] = bins->Angle(bins->Bin(m10[i], m01[i]));
+        return;
+    }
+    if (tolerance > 0)
+    {
+        Atan2(m01, m10, angles, n, PolynomialDegree(tolerance));
+        return;
+    }
+    for (int i = 0; i < n; ++i)
+        angles[i] = cv::fastAtan2(m01[i], m10[i]);
+}
+
+
+int Orientation::PolynomialDegree(float tolerance)
+{
+    return tolerance >= ATAN_P3_ERROR ? 3 : tolerance >= ATAN_P5_ERROR ? 5 : 7;
+}
+
+
+void Orientation::Atan2(const float* y, const float* x, float* angles, int n, int degree)
+{
+    assert(degree == 3 || degree == 5 || degree == 7);
+
+    // c0 + c1*c2 + ... evaluated with unused leading coefficients set to zero
+    const float c3 = degree == 7 ? ATAN_P7[3] : 0.f;
+    const float c2 = degree == 7 ? ATAN_P7[2] : degree == 5 ? ATAN_P5[2] : 0.f;
+    const float c1 = degree == 7 ? ATAN_P7[1] : degree == 5 ? ATAN_P5[1] : ATAN_P3[1];
+    const float c0 = degree == 7 ? ATAN_P7[0] : degree == 5 ? ATAN_P5[0] : ATAN_P3[0];
+
+    int i = 0;
+#ifdef __AVX2__
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    const __m256 eps = _mm256_set1_ps((float)DBL_EPSILON);
+    const __m256 v90 = _mm256_set1_ps(90.f), v180 = _mm256_set1_ps(180.f), v360 = _mm256_set1_ps(360.f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 vy = _mm256_loadu_ps(y + i), vx = _mm256_loadu_ps(x + i);
+        __m256 ax = _mm256_andnot_ps(signMask, vx), ay = _mm256_andnot_ps(signMask, vy);
+        __m256 steep = _mm256_cmp_ps(ay, ax, _CMP_GT_OQ);
+
+        __m256 c = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_add_ps(_mm256_max_ps(ax, ay), eps));
+        __m256 cc = _mm256_mul_ps(c, c);
+        __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(c3), cc), _mm256_set1_ps(c2));
+        a = _mm256_add_ps(_mm256_mul_ps(a, cc), _mm256_set1_ps(c1));
+        a = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(a, cc), _mm256_set1_ps(c0)), c);
+
+        a = _mm256_blendv_ps(a, _mm256_sub_ps(v90, a), steep);
+        a = _mm256_blendv_ps(a, _mm256_sub_ps(v180, a), _mm256_cmp_ps(vx, zero, _CMP_LT_OQ));
+        a = _mm256_blendv_ps(a, _mm256_sub_ps(v360, a), _mm256_cmp_ps(vy, zero, _CMP_LT_OQ));
+        _mm256_storeu_ps(angles + i, a);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const float ax = std::abs(x[i]), ay = std::abs(y[i]);
+        const float c = std::min(ax, ay) / (std::max(ax, ay) + (float)DBL_EPSILON);
+        const float cc = c*c;
+        float a = (((c3*cc + c2)*cc + c1)*cc + c0)*c;
+        if (ay > ax)
+            a = 90.f - a;
+        if (x[i] < 0)
+            a = 180.f - a;
+        if (y[i] < 0)
+            a = 360.f - a;
+        angles[i] = a;
+    }
+}
+
+
+Orientation::Bins::Bins(int _n) : n(_n), edgesBelow{}
+{
+    if (n <= 0)
+        return;
+
+    // edge k lies at (k + 0.5) * width, an angle counts into bin b if exactly b edges (mod n) are at or below it
+    const double width = 360. / n;
+    for (int q = 0; q < 4; ++q)
+    {
+        edgesBelow[q] = std::max(0, (int)std::ceil(q*90. / width - 0.5));
+        for (int k = edgesBelow[q]; (k + 0.5)*width < (q + 1)*90.; ++k)
+        {
+            const double e = ((k + 0.5)*width - q*90.) * CV_PI / 180.;
+            edges[q].emplace_back((float)std::cos(e), (float)std::sin(e));
+        }
+    }
+}
+
+
+int Orientation::Bins::Bin(float m10, float m01) const
+{
+    // rotate by multiples of 90 degrees into x > 0, y >= 0
+    int q;
+    float x, y;
+    if (m10 > 0 && m01 >= 0)
+        q = 0, x = m10, y = m01;
+    else if (m10 <= 0 && m01 > 0)
+        q = 1, x = m01, y = -m10;
+    else if (m10 < 0 && m01 <= 0)
+        q = 2, x = -m10, y = -m01;
+    else if (m10 >= 0 && m01 < 0)
+        q = 3, x = -m01, y = m10;
+    else
+        return 0;
+
+    int count = edgesBelow[q];
+    for (const cv::Point2f &e : edges[q])
+    {
+        if (y*e.x < x*e.y)
+            break;
+        ++count;
+    }
+    return count % n;
+}
@@ -0,0 +1,196 @@
+#include "include/PyramidBlur.h"
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// one sided taps of the Q8 kernel, outermost first, center last
+const int BLUR_K0 = 18;
+const int BLUR_K1 = 34;
+const int BLUR_K2 = 49;
+const int BLUR_K3 = 54;
+
+// horizontal sums (<= 255 << 8) are stored biased by -32768 so the vertical pass can use signed 16 bit madds
+const ushort ROW_BIAS = 0x8000;
+const int VERTICAL_BIAS = (ROW_BIAS << 8) + (1 << 15);
+
+
+void PyramidBlur::Gaussian7x7(const cv::Mat &src, cv::Mat &dst, std::vector<ushort> &rowBuffer)
+{
+    assert(src.type() == CV_8UC1 && dst.type() == CV_8UC1);
+    assert(src.size() == dst.size() && src.data != dst.data);
+
+    const int width = src.cols;
+    const int height = src.rows;
+    const auto step = (ptrdiff_t)src.step;
+
+    rowBuffer.resize((size_t)7 * width);
+    ushort* ring[7];
+    for (int i = 0; i < 7; ++i)
+        ring[i] = &rowBuffer[(size_t)i * width];
+
+    // rows -3..3 are consumed by output row 0, after that each output row adds one horizontal row to the ring
+    for (int r = -3; r < 3; ++r)
+        HorizontalPass(src.data + r*step, ring[r + 3], width);
+
+    for (int y = 0; y < height; ++y)
+    {
+        HorizontalPass(src.data + (y + 3)*step, ring[(y + 6) % 7], width);
+
+        const ushort* rows[7];
+        for (int i = 0; i < 7; ++i)
+            rows[i] = ring[(y + i) % 7];
+
+        VerticalPass(rows, dst.ptr<uchar>(y), width);
+    }
+}
+
+
+void PyramidBlur::Gaussian7x7Sparse(const cv::Mat &src, cv::Mat &dst, const std::vector<knuff::KeyPoint> &kpts,
+                                    std::vector<uchar> &tileMask, std::vector<ushort> &rowBuffer)
+{
+    const int width = src.cols;
+    const int height = src.rows;
+    const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    tileMask.assign((size_t)tilesX * tilesY, 0);
+
+    for (auto &kpt : kpts)
+    {
+        const int x = (int)lrint(kpt.pt.x), y = (int)lrint(kpt.pt.y);
+        const int tx0 = std::max(x - FOOTPRINT_RADIUS, 0) / TILE_SIZE;
+        const int tx1 = std::min(x + FOOTPRINT_RADIUS, width - 1) / TILE_SIZE;
+        const int ty0 = std::max(y - FOOTPRINT_RADIUS, 0) / TILE_SIZE;
+        const int ty1 = std::min(y + FOOTPRINT_RADIUS, height - 1) / TILE_SIZE;
+
+        for (int ty = ty0; ty <= ty1; ++ty)
+            std::fill(&tileMask[(size_t)ty*tilesX + tx0], &tileMask[(size_t)ty*tilesX + tx1] + 1, 1);
+    }
+
+    for (int ty = 0; ty < tilesY; ++ty)
+    {
+        const uchar* maskRow = &tileMask[(size_t)ty*tilesX];
+        const int y0 = ty * TILE_SIZE;
+        const int rows = std::min(TILE_SIZE, height - y0);
+
+        for (int tx = 0; tx < tilesX; )
+        {
+            if (!maskRow[tx])
+            {
+                ++tx;
+                continue;
+            }
+
+            int runEnd = tx;
+            while (runEnd < tilesX && maskRow[runEnd])
+                ++runEnd;
+
+            const int x0 = tx * TILE_SIZE;
+            const cv::Rect run(x0, y0, std::min(runEnd * TILE_SIZE, width) - x0, rows);
+            cv::Mat dstRun = dst(run);
+            Gaussian7x7(src(run), dstRun, rowBuffer);
+
+            tx = runEnd;
+        }
+    }
+}
+
+
+bool PyramidBlur::PreferSparse(const cv::Size levelSize, const int expectedKpts)
+{
+    const double tilesPerSide = (2.*FOOTPRINT_RADIUS + TILE_SIZE) / TILE_SIZE;
+    const double tileCost = TILE_SIZE * (TILE_SIZE + 6);
+    const double sparseCost = expectedKpts * tilesPerSide * tilesPerSide * tileCost;
+
+    return sparseCost < 0.5 * levelSize.area();
+}
+
+
+void PyramidBlur::HorizontalPass(const uchar* src, ushort* dst, const int width)
+{
+    int x = 0;
+
+#ifdef __AVX2__
+    const __m256i k0 = _mm256_set1_epi16(BLUR_K0);
+    const __m256i k1 = _mm256_set1_epi16(BLUR_K1);
+    const __m256i k2 = _mm256_set1_epi16(BLUR_K2);
+    const __m256i k3 = _mm256_set1_epi16(BLUR_K3);
+    const __m256i bias = _mm256_set1_epi16((short)ROW_BIAS);
+
+    for ( ; x < width - 15; x += 16)
+    {
+        const uchar* p = src + x;
+        __m256i outer = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p - 3))),
+                                         _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 3))));
+        __m256i middle = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p - 2))),
+                                          _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 2))));
+        __m256i inner = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p - 1))),
+                                         _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p + 1))));
+        __m256i center = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+
+        // wraps modulo 2^16, the true sum is at most 65280
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(outer, k0), _mm256_mullo_epi16(middle, k1)),
+                                       _mm256_add_epi16(_mm256_mullo_epi16(inner, k2), _mm256_mullo_epi16(center, k3)));
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_xor_si256(sum, bias));
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        const uchar* p = src + x;
+        int sum = (p[-3] + p[3])*BLUR_K0 + (p[-2] + p[2])*BLUR_K1 + (p[-1] + p[1])*BLUR_K2 + p[0]*BLUR_K3;
+        dst[x] = (ushort)(sum ^ ROW_BIAS);
+    }
+}
+
+
+void PyramidBlur::VerticalPass(const ushort* const rows[7], uchar* dst, const int width)
+{
+    int x = 0;
+
+#ifdef __AVX2__
+    const __m256i k01 = _mm256_set1_epi32((BLUR_K1 << 16) | BLUR_K0);
+    const __m256i k23 = _mm256_set1_epi32((BLUR_K3 << 16) | BLUR_K2);
+    const __m256i k45 = _mm256_set1_epi32((BLUR_K1 << 16) | BLUR_K2);
+    const __m256i k6 = _mm256_set1_epi32(BLUR_K0);
+    const __m256i bias = _mm256_set1_epi32(VERTICAL_BIAS);
+
+    for ( ; x < width - 15; x += 16)
+    {
+        __m256i r[7];
+        for (int i = 0; i < 7; ++i)
+            r[i] = _mm256_loadu_si256((const __m256i*)(rows[i] + x));
+        const __m256i zero = _mm256_setzero_si256();
+
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r[0], r[1]), k01),
+                                      _mm256_madd_epi16(_mm256_unpacklo_epi16(r[2], r[3]), k23));
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(r[4], r[5]), k45));
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(r[6], zero), k6));
+
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r[0], r[1]), k01),
+                                      _mm256_madd_epi16(_mm256_unpackhi_epi16(r[2], r[3]), k23));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(r[4], r[5]), k45));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(r[6], zero), k6));
+
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, bias), 16);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, bias), 16);
+
+        // the unpacks split each 128 bit lane, packing lo/hi per lane restores the pixel order
+        __m256i words = _mm256_packus_epi32(lo, hi);
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm256_castsi256_si128(bytes));
+    }
+#endif
+
+    for ( ; x < width; ++x)
+    {
+        int sum = (short)rows[0][x]*BLUR_K0 + (short)rows[1][x]*BLUR_K1 + (short)rows[2][x]*BLUR_K2 +
+                  (short)rows[3][x]*BLUR_K3 + (short)rows[4][x]*BLUR_K2 + (short)rows[5][x]*BLUR_K1 +
+                  (short)rows[6][x]*BLUR_K0;
+        dst[x] = (uchar)((sum + VERTICAL_BIAS) >> 16);
+    }
+}
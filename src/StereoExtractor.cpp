@@ -0,0 +1,120 @@
+#include "include/StereoExtractor.h"
+#include "include/DescriptorStore.h"
+#include "include/HammingMatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <omp.h>
+
+
+StereoExtractor::StereoExtractor(ORB_SLAM2::ORBextractor &_left, ORB_SLAM2::ORBextractor &_right) :
+        left(_left), right(_right), minDisparity(0.f), maxDisparity(128.f), maxDistance(75)
+{
+}
+
+
+void StereoExtractor::operator()(cv::InputArray leftImage, cv::InputArray rightImage,
+                                 std::vector<knuff::KeyPoint> &leftKeypoints, cv::OutputArray leftDescriptors,
+                                 std::vector<knuff::KeyPoint> &rightKeypoints, cv::OutputArray rightDescriptors,
+                                 std::vector<StereoMatch> &matches, bool distributePerLevel)
+{
+    message_assert("Both extractors need the same pyramid!", left.GetLevels() == right.GetLevels() &&
+                   left.GetScaleFactor() == right.GetScaleFactor());
+    message_assert("Stereo matching needs 256 bit descriptors!",
+                   left.GetDescriptorBits() == 256 && right.GetDescriptorBits() == 256);
+
+    const int threads = omp_get_max_threads();
+    const int rightThreads = std::max(threads / 2, 1);
+    const int leftThreads = std::max(threads - rightThreads, 1);
+    std::exception_ptr leftError, rightError;
+
+    // Both sides are tasks of one team of two. Team size and nesting are set inside each task, which only changes
+    // the task's own data environment, so every parallel region of a side gets its half of the threads and the
+    // settings of the caller are left alone.
+    auto extract = [distributePerLevel](ORB_SLAM2::ORBextractor &extractor, cv::InputArray image,
+                                        std::vector<knuff::KeyPoint> &keypoints, cv::OutputArray descriptors,
+                                        int sideThreads, std::exception_ptr &error)
+    {
+        try
+        {
+            omp_set_max_active_levels(std::max(omp_get_max_active_levels(), 2));
+            omp_set_num_threads(sideThreads);
+            extractor(image, cv::Mat(), keypoints, descriptors, distributePerLevel);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    };
+
+#pragma omp parallel num_threads(2)
+#pragma omp single
+    {
+#pragma omp task shared(rightImage, rightKeypoints, rightDescriptors, rightError)
+        extract(right, rightImage, rightKeypoints, rightDescriptors, rightThreads, rightError);
+#pragma omp task shared(leftImage, leftKeypoints, leftDescriptors, leftError)
+        extract(left, leftImage, leftKeypoints, leftDescriptors, leftThreads, leftError);
+#pragma omp taskwait
+    }
+
+    if (leftError)
+        std::rethrow_exception(leftError);
+    if (rightError)
+        std::rethrow_exception(rightError);
+
+    Match(leftKeypoints, leftDescriptors.getMat(), rightKeypoints, rightDescriptors.getMat(), leftImage.size().height,
+          matches);
+}
+
+
+void StereoExtractor::Match(const std::vector<knuff::KeyPoint> &leftKeypoints, const cv::Mat &leftDescriptors,
+                            const std::vector<knuff::KeyPoint> &rightKeypoints, const cv::Mat &rightDescriptors,
+                            int rows, std::vector<StereoMatch> &matches) const
+{
+    matches.clear();
+    if (leftKeypoints.empty() || rightKeypoints.empty())
+        return;
+
+    const std::vector<float> scales = left.GetScaleFactors();
+    const DescriptorStore leftStore(leftDescriptors), rightStore(rightDescriptors);
+
+    std::vector<std::vector<int>> rowIndices(rows);
+    for (int r = 0; r < (int)rightKeypoints.size(); ++r)
+    {
+        const knuff::KeyPoint &kpt = rightKeypoints[r];
+        const float band = 2.f * scales[kpt.octave];
+        const int minRow = std::max((int)std::floor(kpt.pt.y - band), 0);
+        const int maxRow = std::min((int)std::ceil(kpt.pt.y + band), rows - 1);
+        for (int y = minRow; y <= maxRow; ++y)
+            rowIndices[y].emplace_back(r);
+    }
+
+    const int nleft = (int)leftKeypoints.size();
+    std::vector<StereoMatch> best(nleft, StereoMatch{-1, -1, maxDistance + 1, 0.f});
+
+#pragma omp parallel for schedule(dynamic, 32)
+    for (int l = 0; l < nleft; ++l)
+    {
+        const knuff::KeyPoint &kpt = leftKeypoints[l];
+        const int y = std::min(std::max((int)lrint(kpt.pt.y), 0), rows - 1);
+        StereoMatch &m = best[l];
+
+        for (int r : rowIndices[y])
+        {
+            const knuff::KeyPoint &candidate = rightKeypoints[r];
+            const float disparity = kpt.pt.x - candidate.pt.x;
+            if (std::abs(candidate.octave - kpt.octave) > 1 || disparity < minDisparity || disparity > maxDisparity)
+                continue;
+
+            const int d = HammingMatcher::Distance(leftStore.Words(l), rightStore.Words(r));
+            if (d < m.distance)
+                m = StereoMatch{l, r, d, disparity};
+        }
+    }
+
+    for (const StereoMatch &m : best)
+    {
+        if (m.right >= 0)
+            matches.emplace_back(m);
+    }
+}
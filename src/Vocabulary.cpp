@@ -0,0 +1,354 @@
+#include "include/Vocabulary.h"
+#include "include/HammingMatcher.h"
+#include "include/FeatureFileInterface.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+
+const char FILE_MAGIC[8] = {'O', 'R', 'B', 'V', 'O', 'C', '1', '\0'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t nnodes;
+    uint32_t nwords;
+    uint32_t branching;
+    uint32_t depth;
+    uint32_t scoring;
+    uint32_t weighting;
+};
+
+/** byte offsets of nodes, node descriptors and word weights in the file, followed by the file size */
+template <typename Node>
+void FileLayout(uint64_t nnodes, uint64_t nwords, size_t sections[4])
+{
+    sections[0] = MappedFile::Padded(sizeof(FileHeader));
+    sections[1] = sections[0] + MappedFile::Padded(nnodes * sizeof(Node));
+    sections[2] = sections[1] + MappedFile::Padded(nnodes * DescriptorStore::ROW_BYTES);
+    sections[3] = sections[2] + MappedFile::Padded(nwords * sizeof(float));
+}
+
+}
+
+
+Vocabulary::Vocabulary() :
+        nnodes(0), nwords(0), branching(0), depth(0), scoring(L1_NORM), weighting(TF_IDF), nodes(nullptr),
+        descriptors(nullptr), weights(nullptr)
+{
+}
+
+
+Vocabulary::~Vocabulary()
+{
+    Release();
+}
+
+
+void Vocabulary::Release()
+{
+    mapped.Close();
+
+    ownedNodes.clear();
+    ownedDescriptors.Assign(cv::Mat());
+    ownedWeights.clear();
+    nnodes = nwords = branching = depth = 0;
+    nodes = nullptr;
+    descriptors = nullptr;
+    weights = nullptr;
+}
+
+
+bool Vocabulary::LoadText(const std::string &filename)
+{
+    Release();
+
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << filename << "...\n";
+        return false;
+    }
+
+    int k = 0, levels = 0, scoringType = -1, weightingType = -1;
+    std::string line;
+    std::getline(file, line);
+    if (sscanf(line.c_str(), "%d %d %d %d", &k, &levels, &scoringType, &weightingType) != 4 ||
+        k <= 0 || levels <= 0 || scoringType < L1_NORM || scoringType > DOT_PRODUCT ||
+        weightingType < TF_IDF || weightingType > BINARY)
+    {
+        std::cerr << filename << " is not a vocabulary file...\n";
+        return false;
+    }
+
+    // nodes in file order, the root is node 0 and has no line
+    std::vector<uint32_t> parent(1, 0);
+    std::vector<int32_t> fileWord(1, -1);
+    std::vector<uchar> fileDescriptors(DescriptorStore::ROW_BYTES, 0);
+    std::vector<float> wordWeights;
+
+    while (std::getline(file, line))
+    {
+        const char* p = line.c_str();
+        char* end;
+        long pid = strtol(p, &end, 10);
+        if (end == p)
+            continue;
+        long isLeaf = strtol(p = end, &end, 10);
+        bool valid = end != p && pid >= 0 && (size_t)pid < parent.size();
+        for (int i = 0; valid && i < DescriptorStore::ROW_BYTES; ++i)
+        {
+            long value = strtol(p = end, &end, 10);
+            valid = end != p && value >= 0 && value <= 255;
+            fileDescriptors.emplace_back((uchar)value);
+        }
+        double weight = strtod(p = end, &end);
+        if (!valid || end == p)
+        {
+            std::cerr << filename << " has an invalid node at line " << parent.size() + 1 << "...\n";
+            return false;
+        }
+
+        parent.emplace_back((uint32_t)pid);
+        fileWord.emplace_back(isLeaf ? (int32_t)wordWeights.size() : -1);
+        if (isLeaf)
+            wordWeights.emplace_back((float)weight);
+    }
+
+    const auto n = (uint32_t)parent.size();
+    std::vector<uint32_t> childStart(n + 1, 0), children(n - 1);
+    for (uint32_t i = 1; i < n; ++i)
+        ++childStart[parent[i] + 1];
+    for (uint32_t i = 0; i < n; ++i)
+        childStart[i + 1] += childStart[i];
+    {
+        std::vector<uint32_t> cursor(childStart.begin(), childStart.end() - 1);
+        for (uint32_t i = 1; i < n; ++i)
+            children[cursor[parent[i]]++] = i;
+    }
+
+    // breadth first relayout, so the children of every node follow each other in file order
+    std::vector<uint32_t> order(1, 0);
+    order.reserve(n);
+    ownedNodes.resize(n);
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+        const uint32_t old = order[i];
+        const uint32_t count = childStart[old + 1] - childStart[old];
+        if ((fileWord[old] >= 0) != (count == 0))
+        {
+            std::cerr << filename << " has leaves with children or inner nodes without...\n";
+            Release();
+            return false;
+        }
+        ownedNodes[i] = Node {(uint32_t)order.size(), count, fileWord[old], 0};
+        order.insert(order.end(), children.begin() + childStart[old], children.begin() + childStart[old + 1]);
+    }
+
+    cv::Mat nodeDescriptors((int)n, DescriptorStore::ROW_BYTES, CV_8U);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        memcpy(nodeDescriptors.ptr(i), &fileDescriptors[(size_t)order[i] * DescriptorStore::ROW_BYTES],
+               DescriptorStore::ROW_BYTES);
+    }
+    ownedDescriptors.Assign(nodeDescriptors);
+    ownedWeights = std::move(wordWeights);
+
+    nnodes = n;
+    nwords = (uint32_t)ownedWeights.size();
+    branching = (uint32_t)k;
+    depth = (uint32_t)levels;
+    scoring = (Scoring)scoringType;
+    weighting = (Weighting)weightingType;
+    nodes = ownedNodes.data();
+    descriptors = ownedDescriptors.Words(0);
+    weights = ownedWeights.data();
+    return true;
+}
+
+
+bool Vocabulary::Save(const std::string &filename) const
+{
+    FileHeader header{};
+    memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.nnodes = nnodes;
+    header.nwords = nwords;
+    header.branching = branching;
+    header.depth = depth;
+    header.scoring = scoring;
+    header.weighting = weighting;
+
+    return MappedFile::Write(filename, {{&header, sizeof(header)},
+                                        {nodes, (size_t)nnodes * sizeof(Node)},
+                                        {descriptors, (size_t)nnodes * DescriptorStore::ROW_BYTES},
+                                        {weights, (size_t)nwords * sizeof(float)}});
+}
+
+
+bool Vocabulary::Load(const std::string &filename)
+{
+    Release();
+    if (!mapped.Open(filename))
+        return false;
+
+    const auto header = (const FileHeader*)mapped.Data();
+    size_t sections[4] = {};
+    bool valid = mapped.Size() >= sizeof(FileHeader) && memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 &&
+                 header->nnodes > 0 && header->scoring <= DOT_PRODUCT && header->weighting <= BINARY;
+    if (valid)
+    {
+        FileLayout<Node>(header->nnodes, header->nwords, sections);
+        valid = sections[3] <= mapped.Size();
+    }
+    if (!valid)
+    {
+        std::cerr << filename << " is not a vocabulary file...\n";
+        Release();
+        return false;
+    }
+
+    const uchar* base = mapped.Data();
+    nnodes = header->nnodes;
+    nwords = header->nwords;
+    branching = header->branching;
+    depth = header->depth;
+    scoring = (Scoring)header->scoring;
+    weighting = (Weighting)header->weighting;
+    nodes = (const Node*)(base + sections[0]);
+    descriptors = (const uint64_t*)(base + sections[1]);
+    weights = (const float*)(base + sections[2]);
+    return true;
+}
+
+
+uint32_t Vocabulary::Word(const uint64_t* descriptor) const
+{
+    assert(nnodes > 0);
+    const Node* node = nodes;
+    while (node->word < 0)
+    {
+        // the first closest child wins, as in DBoW2
+        const uint32_t first = node->firstChild, count = node->childCount;
+        const uint64_t* child = descriptors + (size_t)first * DescriptorStore::ROW_WORDS;
+        uint32_t best = first;
+        int bestDistance = HammingMatcher::NO_DISTANCE;
+
+        uint32_t c = 0;
+        for (; c + 4 <= count; c += 4, child += 4 * DescriptorStore::ROW_WORDS)
+        {
+            int d[4];
+            HammingMatcher::Distance4(descriptor, child, child + DescriptorStore::ROW_WORDS,
+                                      child + 2 * DescriptorStore::ROW_WORDS, child + 3 * DescriptorStore::ROW_WORDS,
+                                      d);
+            for (int j = 0; j < 4; ++j)
+            {
+                if (d[j] < bestDistance)
+                {
+                    bestDistance = d[j];
+                    best = first + c + j;
+                }
+            }
+        }
+        for (; c < count; ++c, child += DescriptorStore::ROW_WORDS)
+        {
+            int d = HammingMatcher::Distance(descriptor, child);
+            if (d < bestDistance)
+            {
+                bestDistance = d;
+                best = first + c;
+            }
+        }
+        node = nodes + best;
+    }
+    return (uint32_t)node->word;
+}
+
+
+void Vocabulary::Transform(const DescriptorStore &_descriptors, BowVector &bow, std::vector<uint32_t>* wordIds) const
+{
+    message_assert("Vocabulary is empty!", nwords > 0);
+    bow.clear();
+    const int n = _descriptors.Size();
+
+    std::vector<uint32_t> localWords;
+    std::vector<uint32_t> &words = wordIds ? *wordIds : localWords;
+    words.resize(n);
+
+#pragma omp parallel for schedule(dynamic, 32)
+    for (int i = 0; i < n; ++i)
+        words[i] = Word(_descriptors.Words(i));
+
+    std::vector<uint32_t> sorted(words);
+    std::sort(sorted.begin(), sorted.end());
+
+    // TF and TF-IDF add up the weight of every occurrence, IDF and binary weighting count every word once
+    const bool accumulate = weighting == TF_IDF || weighting == TF;
+    for (int i = 0; i < n; )
+    {
+        const uint32_t word = sorted[i];
+        int occurrences = 1;
+        while (i + occurrences < n && sorted[i + occurrences] == word)
+            ++occurrences;
+        i += occurrences;
+
+        const float weight = weights[word];
+        if (weight > 0)
+            bow.emplace_back(word, accumulate ? weight * (float)occurrences : weight);
+    }
+
+    if (scoring == DOT_PRODUCT || bow.empty())
+        return;
+
+    double norm = 0;
+    if (scoring == L2_NORM)
+    {
+        for (const auto &entry : bow)
+            norm += (double)entry.second * entry.second;
+        norm = std::sqrt(norm);
+    }
+    else
+    {
+        for (const auto &entry : bow)
+            norm += std::fabs(entry.second);
+    }
+    if (norm > 0)
+    {
+        for (auto &entry : bow)
+            entry.second = (float)(entry.second / norm);
+    }
+}
+
+
+void Vocabulary::Transform(const cv::Mat &_descriptors, BowVector &bow, std::vector<uint32_t>* wordIds) const
+{
+    DescriptorStore store(_descriptors);
+    Transform(store, bow, wordIds);
+}
+
+
+double Vocabulary::Score(const BowVector &a, const BowVector &b)
+{
+    // sum |a - b| = sum a + sum b - sum over shared words of (a + b - |a - b|), both sums are 1
+    double shared = 0;
+    auto ia = a.begin(), ib = b.begin();
+    while (ia != a.end() && ib != b.end())
+    {
+        if (ia->first < ib->first)
+            ++ia;
+        else if (ib->first < ia->first)
+            ++ib;
+        else
+        {
+            shared += std::fabs(ia->second) + std::fabs(ib->second) - std::fabs(ia->second - ib->second);
+            ++ia;
+            ++ib;
+        }
+    }
+    return 0.5 * shared;
+}
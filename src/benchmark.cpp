@@ -0,0 +1,517 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "include/ORBextractor.h"
+#include "include/HammingMatcher.h"
+
+/**
+ * Extraction benchmark without visualisation:
+ * ORBbenchmark [settings] [image ...]
+ * Without images, synthetic 1080p and 4K frames are used. Every image is run with the regular and the striped
+ * level 0 pipeline, reporting time per frame and, if perf events are available, last level cache misses per
+ * frame as an estimate of DRAM traffic. Afterwards extraction is timed with 1, 2, 4, ... OpenMP threads up to
+ * omp_get_max_threads(), checking that descriptors are identical to the single threaded ones. Finally both BRIEF
+ * smoothing modes are compared by matching every grayscale image against a rotated and noisy copy of itself, the
+ * octave anchored pyramid against the default one by repeated keypoints and matches, and 128, 256 and 512 bit
+ * descriptors by throughput and storage. Describing the keypoints of level 0 is timed with
+ * and without footprint prefetching.
+ */
+
+using namespace std;
+
+
+class CacheMissCounter
+{
+public:
+    CacheMissCounter() : fd(-1)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~CacheMissCounter()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool inline Available()
+    {
+        return fd >= 0;
+    }
+
+    void Start()
+    {
+        if (fd < 0)
+            return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long Stop()
+    {
+        if (fd < 0)
+            return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+            return -1;
+        return count;
+    }
+
+private:
+    int fd;
+};
+
+
+static cv::Mat SyntheticFrame(int width, int height, int seed)
+{
+    std::mt19937 rng(seed);
+    cv::Mat img(height, width, CV_8UC1);
+    for (int y = 0; y < height; ++y)
+    {
+        auto row = img.ptr<uchar>(y);
+        for (int x = 0; x < width; ++x)
+        {
+            double v = 128 + 60*std::sin(x*0.031 + seed)*std::cos(y*0.027) + 30*std::sin((x + y)*0.11) +
+                    (int)(rng() % 24);
+            row[x] = (uchar)std::max(0., std::min(255., v));
+        }
+    }
+    for (int i = 0; i < width*height/2000; ++i)
+    {
+        cv::Rect r(rng() % width, rng() % height, 4 + rng() % 24, 4 + rng() % 24);
+        img(r & cv::Rect(0, 0, width, height)).setTo(cv::Scalar(rng() & 255));
+    }
+    return img;
+}
+
+
+static void RunBenchmark(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor, int nLevels,
+                         int iniThFAST, int minThFAST, int iterations, CacheMissCounter &counter)
+{
+    for (int striped = 0; striped < 2; ++striped)
+    {
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+        extractor.EnableStripedLevel0(striped != 0);
+
+        vector<knuff::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        extractor(image, cv::Mat(), keypoints, descriptors, true);
+
+        counter.Start();
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor(image, cv::Mat(), keypoints, descriptors, true);
+        auto t1 = chrono::high_resolution_clock::now();
+        long long misses = counter.Stop();
+
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+        cout << left << setw(12) << name << setw(10) << (striped ? "striped" : "regular") << right << fixed <<
+             setprecision(2) << setw(10) << ms << " ms" << setw(8) << keypoints.size() << " kpts";
+        if (misses >= 0)
+            cout << setw(12) << setprecision(1) << misses * 64. / iterations / (1024*1024) << " MiB LLC misses";
+        cout << "\n";
+    }
+}
+
+
+static void RunThreadScaling(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor,
+                             int nLevels, int iniThFAST, int minThFAST, int iterations)
+{
+    const int maxThreads = omp_get_max_threads();
+    cv::Mat reference;
+    double singleThreaded = 0;
+
+    for (int threads = 1; ; threads = std::min(2*threads, maxThreads))
+    {
+        omp_set_num_threads(threads);
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+
+        vector<knuff::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        extractor(image, cv::Mat(), keypoints, descriptors, true);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor(image, cv::Mat(), keypoints, descriptors, true);
+        auto t1 = chrono::high_resolution_clock::now();
+
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+        bool identical = true;
+        if (threads == 1)
+        {
+            reference = descriptors.clone();
+            singleThreaded = ms;
+        }
+        else
+        {
+            identical = reference.size() == descriptors.size() &&
+                        std::equal(reference.data, reference.data + reference.total(), descriptors.data);
+        }
+
+        cout << left << setw(12) << name << setw(3) << threads << setw(7) << "threads" << right << fixed <<
+             setprecision(2) << setw(10) << ms << " ms" << setw(8) << singleThreaded / ms << "x" <<
+             (identical ? "" : "  descriptors differ from 1 thread!") << "\n";
+
+        if (threads == maxThreads)
+            break;
+    }
+    omp_set_num_threads(maxThreads);
+}
+
+
+/** copy of image rotated by 10 degrees around its center with uniform noise of +-8 */
+static cv::Mat RotatedNoisyCopy(const cv::Mat &image, const cv::Mat &rotation)
+{
+    cv::Mat rotated;
+    cv::warpAffine(image, rotated, rotation, image.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
+    std::mt19937 rng(7);
+    for (int y = 0; y < rotated.rows; ++y)
+    {
+        auto row = rotated.ptr<uchar>(y);
+        for (int x = 0; x < rotated.cols; ++x)
+            row[x] = (uchar)std::max(0, std::min(255, row[x] + (int)(rng() % 17) - 8));
+    }
+    return rotated;
+}
+
+
+/** A ratio test match is correct if the rotated keypoint lies within 3 pixels (scaled to its level) of the other. */
+static int CorrectMatches(const vector<knuff::KeyPoint> &keypoints, const cv::Mat &descriptors,
+                          const vector<knuff::KeyPoint> &rotatedKeypoints, const cv::Mat &rotatedDescriptors,
+                          const cv::Mat &rotation, float scaleFactor, vector<HammingMatcher::Match> &matches)
+{
+    HammingMatcher::RatioMatch(DescriptorStore(descriptors), DescriptorStore(rotatedDescriptors), matches);
+    int correct = 0;
+    for (const HammingMatcher::Match &m : matches)
+    {
+        const knuff::KeyPoint &kpt = keypoints[m.query], &other = rotatedKeypoints[m.train];
+        const double x = rotation.at<double>(0, 0)*kpt.pt.x + rotation.at<double>(0, 1)*kpt.pt.y +
+                         rotation.at<double>(0, 2);
+        const double y = rotation.at<double>(1, 0)*kpt.pt.x + rotation.at<double>(1, 1)*kpt.pt.y +
+                         rotation.at<double>(1, 2);
+        const double tolerance = 3. * std::pow(scaleFactor, kpt.octave);
+        if (std::hypot(x - other.pt.x, y - other.pt.y) <= tolerance)
+            ++correct;
+    }
+    return correct;
+}
+
+
+/** Both BRIEF smoothing modes, matching against RotatedNoisyCopy, see CorrectMatches */
+static void RunSmoothingComparison(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor,
+                                   int nLevels, int iniThFAST, int minThFAST, int iterations)
+{
+    if (image.type() != CV_8UC1)
+        return;
+
+    const cv::Mat rotation = cv::getRotationMatrix2D(cv::Point2f(image.cols / 2.f, image.rows / 2.f), 10., 1.);
+    const cv::Mat rotated = RotatedNoisyCopy(image, rotation);
+
+    for (BRIEF::Smoothing smoothing : {BRIEF::GAUSSIAN, BRIEF::BOX})
+    {
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+        extractor.SetDescriptorSmoothing(smoothing);
+
+        vector<knuff::KeyPoint> keypoints, rotatedKeypoints;
+        cv::Mat descriptors, rotatedDescriptors;
+        extractor(rotated, cv::Mat(), rotatedKeypoints, rotatedDescriptors, true);
+        extractor(image, cv::Mat(), keypoints, descriptors, true);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor(image, cv::Mat(), keypoints, descriptors, true);
+        auto t1 = chrono::high_resolution_clock::now();
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+
+        vector<HammingMatcher::Match> matches;
+        const int correct = CorrectMatches(keypoints, descriptors, rotatedKeypoints, rotatedDescriptors, rotation,
+                                           scaleFactor, matches);
+
+        cout << left << setw(12) << name << setw(10) << (smoothing == BRIEF::BOX ? "box" : "gaussian") << right <<
+             fixed << setprecision(2) << setw(10) << ms << " ms" << setw(8) << matches.size() << " matches" <<
+             setw(8) << setprecision(1) << (matches.empty() ? 0. : 100. * correct / matches.size()) <<
+             " % correct\n";
+    }
+}
+
+
+/**
+ * The octave anchored pyramid against the default one: time per frame, share of the keypoints above level 0 that
+ * the default pyramid finds on the same level within one level pixel, mean Hamming distance of the descriptors of
+ * those at the same position, and correct matches against RotatedNoisyCopy as in RunSmoothingComparison.
+ * Afterwards the pyramid alone is timed with 4, 8 and 12 levels at scale 1.05 and scaleFactor, by describing one
+ * keypoint on the top level with DescribeKeypoints (all levels, the top level blurred).
+ */
+static void RunPyramidComparison(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor,
+                                 int nLevels, int iniThFAST, int minThFAST, int iterations)
+{
+    if (image.type() != CV_8UC1)
+        return;
+
+    const cv::Mat rotation = cv::getRotationMatrix2D(cv::Point2f(image.cols / 2.f, image.rows / 2.f), 10., 1.);
+    const cv::Mat rotated = RotatedNoisyCopy(image, rotation);
+
+    vector<knuff::KeyPoint> reference;
+    cv::Mat referenceDescriptors;
+    {
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+        extractor(image, cv::Mat(), reference, referenceDescriptors, true);
+    }
+
+    for (bool anchored : {false, true})
+    {
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+        extractor.EnableOctaveAnchoredPyramid(anchored);
+
+        vector<knuff::KeyPoint> keypoints, rotatedKeypoints;
+        cv::Mat descriptors, rotatedDescriptors;
+        extractor(rotated, cv::Mat(), rotatedKeypoints, rotatedDescriptors, true);
+        extractor(image, cv::Mat(), keypoints, descriptors, true);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor(image, cv::Mat(), keypoints, descriptors, true);
+        auto t1 = chrono::high_resolution_clock::now();
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+
+        int upper = 0, repeated = 0, samePosition = 0;
+        long hamming = 0;
+        for (int i = 0; i < (int)keypoints.size(); ++i)
+        {
+            const knuff::KeyPoint &kpt = keypoints[i];
+            if (kpt.octave == 0)
+                continue;
+            ++upper;
+            const double levelPixel = std::pow(scaleFactor, kpt.octave);
+            int closest = -1;
+            double closestDistance = levelPixel;
+            for (int j = 0; j < (int)reference.size(); ++j)
+            {
+                const double d = std::hypot(kpt.pt.x - reference[j].pt.x, kpt.pt.y - reference[j].pt.y);
+                if (reference[j].octave == kpt.octave && d <= closestDistance)
+                {
+                    closest = j;
+                    closestDistance = d;
+                }
+            }
+            if (closest < 0)
+                continue;
+            ++repeated;
+            if (closestDistance < 0.01 * levelPixel)
+            {
+                ++samePosition;
+                hamming += HammingMatcher::Distance((const uint64_t*)descriptors.ptr(i),
+                                                    (const uint64_t*)referenceDescriptors.ptr(closest));
+            }
+        }
+
+        vector<HammingMatcher::Match> matches;
+        const int correct = CorrectMatches(keypoints, descriptors, rotatedKeypoints, rotatedDescriptors, rotation,
+                                           scaleFactor, matches);
+
+        cout << left << setw(12) << name << setw(10) << (anchored ? "anchored" : "default") << right << fixed <<
+             setprecision(2) << setw(10) << ms << " ms" << setw(8) << setprecision(1) <<
+             (upper ? 100. * repeated / upper : 0.) << " % repeated" << setw(8) <<
+             (samePosition ? (double)hamming / samePosition : 0.) << " bits apart" << setw(8) <<
+             (matches.empty() ? 0. : 100. * correct / matches.size()) << " % correct\n";
+    }
+
+    for (float scale : {1.05f, scaleFactor})
+    {
+        for (int levels : {4, 8, 12})
+        {
+            cout << left << setw(12) << name << "scale " << fixed << setprecision(2) << scale << setw(3) << right <<
+                 levels << " levels";
+            for (bool anchored : {false, true})
+            {
+                ORB_SLAM2::ORBextractor extractor(nFeatures, scale, levels, iniThFAST, minThFAST);
+                extractor.EnableOctaveAnchoredPyramid(anchored);
+
+                const float topScale = std::pow(scale, levels - 1);
+                vector<knuff::KeyPoint> top(1, knuff::KeyPoint(image.cols / 2.f, image.rows / 2.f, 31.f * topScale,
+                                                               0.f, 0.f, levels - 1));
+                cv::Mat descriptors;
+                extractor.DescribeKeypoints(image, top, descriptors);
+
+                auto t0 = chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; ++i)
+                    extractor.DescribeKeypoints(image, top, descriptors);
+                auto t1 = chrono::high_resolution_clock::now();
+                double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+                cout << setw(10) << (anchored ? "anchored" : "default") << fixed << setprecision(2) << setw(10) <<
+                     ms << " ms";
+            }
+            cout << "\n";
+        }
+    }
+}
+
+
+/**
+ * Time per frame of the whole extraction and descriptor throughput of DescribeKeypoints on the same keypoints
+ * (pyramid, blur and BRIEF without detection), with the descriptor storage of a frame.
+ */
+static void RunDescriptorLengths(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor,
+                                 int nLevels, int iniThFAST, int minThFAST, int iterations)
+{
+    for (int bits : {128, 256, 512})
+    {
+        ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, bits);
+
+        vector<knuff::KeyPoint> keypoints;
+        cv::Mat descriptors;
+        extractor(image, cv::Mat(), keypoints, descriptors, true);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor(image, cv::Mat(), keypoints, descriptors, true);
+        auto t1 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor.DescribeKeypoints(image, keypoints, descriptors);
+        auto t2 = chrono::high_resolution_clock::now();
+
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+        double describeMs = chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000. / iterations;
+        const size_t bytes = descriptors.total() * descriptors.elemSize();
+        cout << left << setw(12) << name << setw(4) << bits << setw(6) << "bits" << right << fixed <<
+             setprecision(2) << setw(10) << ms << " ms" << setw(10) << describeMs << " ms describe" <<
+             setw(10) << setprecision(0) << keypoints.size() / describeMs << " kpts/ms" << setw(8) <<
+             bytes / 1024. << " KiB/frame\n";
+    }
+}
+
+
+/**
+ * Level 0 is the largest level, so its keypoint footprints are least likely to be cached. Keypoints found on it are
+ * described again with DescribeKeypoints, which only builds and blurs level 0 for them.
+ */
+static void RunFootprintPrefetch(const string &name, const cv::Mat &image, int nFeatures, float scaleFactor,
+                                 int nLevels, int iniThFAST, int minThFAST, int iterations)
+{
+    ORB_SLAM2::ORBextractor extractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+    extractor.SetBlurMode(PyramidBlur::FULL);
+
+    vector<knuff::KeyPoint> keypoints;
+    cv::Mat descriptors, reference;
+    extractor(image, cv::Mat(), keypoints, descriptors, true);
+    keypoints.erase(std::remove_if(keypoints.begin(), keypoints.end(),
+                                   [](const knuff::KeyPoint &kpt) { return kpt.octave != 0; }), keypoints.end());
+    if (keypoints.empty())
+        return;
+
+    for (int prefetch = 0; prefetch < 2; ++prefetch)
+    {
+        extractor.EnableFootprintPrefetch(prefetch != 0);
+        extractor.DescribeKeypoints(image, keypoints, descriptors);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            extractor.DescribeKeypoints(image, keypoints, descriptors);
+        auto t1 = chrono::high_resolution_clock::now();
+
+        double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+        bool identical = true;
+        if (prefetch)
+            identical = std::equal(reference.data, reference.data + reference.total(), descriptors.data);
+        else
+            reference = descriptors.clone();
+
+        cout << left << setw(12) << name << setw(12) << (prefetch ? "prefetch" : "no prefetch") << right << fixed <<
+             setprecision(2) << setw(10) << ms << " ms" << setw(8) << keypoints.size() << " level 0 kpts" <<
+             (identical ? "" : "  descriptors differ!") << "\n";
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    CacheMissCounter counter;
+
+    int nFeatures = 1000, nLevels = 8, iniThFAST = 20, minThFAST = 7;
+    float scaleFactor = 1.2f;
+    int firstImage = 1;
+
+    if (argc > 1 && string(argv[1]).find(".yaml") != string::npos)
+    {
+        cv::FileStorage settingsFile(argv[1], cv::FileStorage::READ);
+        if (!settingsFile.isOpened())
+        {
+            cerr << "Failed to load ORB settings at " << argv[1] << "!" << endl;
+            return EXIT_FAILURE;
+        }
+        nFeatures = settingsFile["ORBextractor.nFeatures"];
+        scaleFactor = settingsFile["ORBextractor.scaleFactor"];
+        nLevels = settingsFile["ORBextractor.nLevels"];
+        iniThFAST = settingsFile["ORBextractor.iniThFAST"];
+        minThFAST = settingsFile["ORBextractor.minThFAST"];
+        firstImage = 2;
+    }
+
+    if (!counter.Available())
+        cout << "perf events unavailable, reporting times only\n";
+
+    const int iterations = 20;
+
+    if (argc > firstImage)
+    {
+        for (int i = firstImage; i < argc; ++i)
+        {
+            cv::Mat image = cv::imread(argv[i], cv::IMREAD_UNCHANGED);
+            if (image.empty())
+            {
+                cerr << "Failed to load image at " << argv[i] << "!" << endl;
+                continue;
+            }
+            const string name = to_string(image.cols) + "x" + to_string(image.rows);
+            RunBenchmark(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations, counter);
+            RunThreadScaling(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+            RunSmoothingComparison(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+            RunPyramidComparison(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+            RunDescriptorLengths(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+            RunFootprintPrefetch(name, image, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        }
+    }
+    else
+    {
+        const cv::Mat fullHD = SyntheticFrame(1920, 1080, 1), ultraHD = SyntheticFrame(3840, 2160, 2);
+        RunBenchmark("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations,
+                     counter);
+        RunBenchmark("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations,
+                     counter);
+        RunThreadScaling("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunThreadScaling("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunSmoothingComparison("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST,
+                               iterations);
+        RunSmoothingComparison("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST,
+                               iterations);
+        RunPyramidComparison("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunPyramidComparison("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunDescriptorLengths("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunDescriptorLengths("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunFootprintPrefetch("1920x1080", fullHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+        RunFootprintPrefetch("3840x2160", ultraHD, nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, iterations);
+    }
+
+    return 0;
+}
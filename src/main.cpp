@@ -6,6 +6,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "include/main.h"
+#include "include/StereoExtractor.h"
 #include <pangolin/pangolin.h>
 
 #ifndef NDEBUG
@@ -176,13 +177,10 @@ void SingleImageMode(string &imgPath, int nFeatures, float scaleFactor, int nLev
 
     while (true)
     {
-        cv::Mat imgGray;
-        cv::cvtColor(imgColor, imgGray, CV_BGR2GRAY);
-
         cv::Mat displayImg;
         imgColor.copyTo(displayImg);
 
-        extractor(imgGray, cv::Mat(), keypoints, descriptors, distributePerLevel);
+        extractor(imgColor, cv::Mat(), keypoints, descriptors, distributePerLevel);
 
         if (extractor.GetDistribution() == Distribution::GRID && !distributePerLevel)
         {
@@ -326,6 +324,8 @@ void SequenceMode(string &imgPath, int nFeatures, float scaleFactor, int nLevels
 
     ORB_SLAM2::ORBextractor myExtractor(nFeatures, scaleFactor, nLevels, FASTThresholdInit, FASTThresholdMin);
     ORB_SLAM2::ORBextractor myExtractorRight(nFeatures, scaleFactor, nLevels, FASTThresholdInit, FASTThresholdMin);
+    StereoExtractor stereoExtractor(myExtractor, myExtractorRight);
+    vector<StereoExtractor::StereoMatch> stereoMatches;
 
     cout << "\n-------------------------\n"
            << "Images in sequence: " << nImages << "\n";
@@ -393,7 +393,8 @@ void SequenceMode(string &imgPath, int nFeatures, float scaleFactor, int nLevels
 
     string d = distribution == 0 ? "Top N" : distribution == 1? "ranms" : distribution == 2? "Quadtree" :
             distribution == 3? "Bucketing" : distribution == 4? "KDTree" : distribution == 5? "Range Tree" :
-            distribution == 6? "SSC" : distribution == 7? "All" : distribution == 8? "Soft SSC" : "Reverse Suppression";
+            distribution == 6? "SSC" : distribution == 7? "All" : distribution == 8? "Soft SSC" :
+            distribution == 10? "Exact ANMS" : "Reverse Suppression";
     cv::displayStatusBar(string(imgPath), "Current Distribution: " + d);
 
     int count = 0;
@@ -445,11 +446,13 @@ void SequenceMode(string &imgPath, int nFeatures, float scaleFactor, int nLevels
         chrono::high_resolution_clock::time_point t2 = chrono::high_resolution_clock::now();
 
 
-        myExtractor(img, cv::Mat(), mykpts, mydescriptors, distributePerLevel);
         if (stereo)
         {
-            //myExtractorRight(imgRight, cv::Mat(), mykptsRight, mydescriptorsRight, distributePerLevel);
+            stereoExtractor(img, imgRight, mykpts, mydescriptors, mykptsRight, mydescriptorsRight, stereoMatches,
+                            distributePerLevel);
         }
+        else
+            myExtractor(img, cv::Mat(), mykpts, mydescriptors, distributePerLevel);
 
         chrono::high_resolution_clock ::time_point t3 = chrono::high_resolution_clock::now();
 
@@ -809,14 +812,11 @@ void PerformanceMode(std::string &imgPath, int nFeatures, float scaleFactor, int
         {
             img = cv::imread(string(imgPath) + "/" + vstrImageFilenames[ni], CV_LOAD_IMAGE_UNCHANGED);
 
-            cv::Mat imgGray;
-            cv::cvtColor(img, imgGray, CV_BGR2GRAY);
-
             vector<knuff::KeyPoint> kpts;
             cv::Mat descriptors;
 
             clk::time_point t1 = clk::now();
-            extractor(imgGray, cv::Mat(), kpts, descriptors, true);
+            extractor(img, cv::Mat(), kpts, descriptors, true);
             clk::time_point t2 = clk::now();
             long d = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
             totalDuration += d;
@@ -901,7 +901,7 @@ vector<Descriptor_Pair> CompareDescriptors (cv::Mat &desc1, string name1, cv::Ma
 
     bool eq = true;
 
-    int N = nkpts * 32;
+    int N = nkpts * desc1.cols;
     for (int i = 0; i < N; ++i)
     {
         if ((int)ptr1[i] != (int)ptr2[i])
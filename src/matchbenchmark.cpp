@@ -0,0 +1,120 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <omp.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include "include/ORBextractor.h"
+#include "include/HammingMatcher.h"
+
+/**
+ * Matching benchmark:
+ * ORBmatchBenchmark [image1 image2]
+ * Matches the descriptors extracted from both images, or without images random descriptors against noisy copies
+ * of them (1000 to 8000 rows), with HammingMatcher and with cv::BFMatcher. Reports time per match call, the
+ * number of matches after ratio test and cross check, and whether the best distances agree with cv::BFMatcher.
+ */
+
+using namespace std;
+
+
+static cv::Mat RandomDescriptors(int rows, std::mt19937 &rng)
+{
+    cv::Mat desc(rows, 32, CV_8U);
+    for (int i = 0; i < rows*32; ++i)
+        desc.data[i] = (uchar)rng();
+    return desc;
+}
+
+
+/** every bit flipped with probability 1/16 */
+static cv::Mat FlipBits(const cv::Mat &desc, std::mt19937 &rng)
+{
+    cv::Mat noisy = desc.clone();
+    for (int i = 0; i < noisy.rows*32; ++i)
+    {
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            if (rng() % 16 == 0)
+                noisy.data[i] ^= (uchar)(1 << bit);
+        }
+    }
+    return noisy;
+}
+
+
+static void RunMatching(const string &name, const cv::Mat &queryDesc, const cv::Mat &trainDesc, int iterations)
+{
+    DescriptorStore query(queryDesc), train(trainDesc);
+    vector<HammingMatcher::Match> best, matches;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        HammingMatcher::RatioMatch(query, train, matches);
+    auto t1 = chrono::high_resolution_clock::now();
+    HammingMatcher::KnnMatch2(query, train, best);
+
+    cv::BFMatcher bf(cv::NORM_HAMMING);
+    vector<vector<cv::DMatch>> knn;
+    auto t2 = chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        bf.knnMatch(queryDesc, trainDesc, knn, 2);
+        vector<vector<cv::DMatch>> reverse;
+        bf.knnMatch(trainDesc, queryDesc, reverse, 1);
+    }
+    auto t3 = chrono::high_resolution_clock::now();
+
+    int disagreements = 0;
+    for (size_t q = 0; q < knn.size(); ++q)
+    {
+        if (knn[q].empty() || (int)knn[q][0].distance != best[q].distance ||
+            (knn[q].size() > 1 && (int)knn[q][1].distance != best[q].secondDistance))
+            ++disagreements;
+    }
+
+    double ms = chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000. / iterations;
+    double bfms = chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000. / iterations;
+    cout << left << setw(14) << name << right << setw(6) << query.Size() << " x" << setw(6) << train.Size() <<
+         fixed << setprecision(3) << setw(10) << ms << " ms" << setw(10) << bfms << " ms BFMatcher" <<
+         setprecision(1) << setw(8) << bfms / ms << "x" << setw(7) << matches.size() << " matches" <<
+         (disagreements ? "  distances differ from BFMatcher: " + to_string(disagreements) : "") << "\n";
+}
+
+
+int main(int argc, char **argv)
+{
+    const int iterations = 10;
+    cout << omp_get_max_threads() << " threads\n";
+
+    if (argc > 2)
+    {
+        ORB_SLAM2::ORBextractor extractor(1000, 1.2f, 8, 20, 7);
+        cv::Mat descriptors[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            cv::Mat image = cv::imread(argv[i + 1], cv::IMREAD_UNCHANGED);
+            if (image.empty())
+            {
+                cerr << "Failed to load image at " << argv[i + 1] << "!" << endl;
+                return EXIT_FAILURE;
+            }
+            vector<knuff::KeyPoint> keypoints;
+            extractor(image, cv::Mat(), keypoints, descriptors[i], true);
+        }
+        RunMatching("images", descriptors[0], descriptors[1], iterations);
+    }
+    else
+    {
+        std::mt19937 rng(1);
+        for (int rows : {1000, 2000, 4000, 8000})
+        {
+            cv::Mat train = RandomDescriptors(rows, rng);
+            RunMatching("random", FlipBits(train, rng), train, iterations);
+        }
+    }
+
+    return 0;
+}